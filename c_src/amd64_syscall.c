@@ -12,9 +12,9 @@ BUILTIN_TYPE(OSError, exception, exc_constructor);
 
 BasicObject g_sys = {
 	.header_dict.header = {
-		.table = &object_table,
+		.table_id = TABLE_OBJECT,
 		.type = &g_object,
-		.group = &root_threadgroup,
+		.group_id = ROOT_GROUP_ID,
 	},
 };
 STATIC_OBJECT(g_sys);
@@ -158,8 +158,8 @@ Object *builtin_sys_##name(TupleObject *args) { \
 BuiltinFunctionObject g_sys_##name = { \
 	.header = { \
 		.type = &g_builtin, \
-		.table = &builtinfunction_table, \
-		.group = &root_threadgroup, \
+		.table_id = TABLE_BUILTINFUNCTION, \
+		.group_id = ROOT_GROUP_ID, \
 	}, \
 	.func = builtin_sys_##name, \
 }; \
@@ -169,8 +169,8 @@ ADD_MEMBER(g_sys, #name, g_sys_##name)
 #define SYS_LIT(name) \
 IntObject g_##name = { \
 	.header.type = &g_int, \
-	.header.table = &int_table, \
-	.header.group = &root_threadgroup, \
+	.header.table_id = TABLE_INT, \
+	.header.group_id = ROOT_GROUP_ID, \
 	.value = (name), \
 }; \
 STATIC_OBJECT(g_##name); \
@@ -3,6 +3,7 @@
 #include <alloca.h>
 #include <stdarg.h>
 #include <time.h>
+#include <errno.h>
 
 #include "builtins.h"
 #include "object.h"
@@ -12,9 +13,9 @@
 
 DictObject builtins = {
 	.header = {
-		.table = &dicto_table,
+		.table_id = TABLE_DICTO,
 		.type = &g_dict,
-		.group = &root_threadgroup,
+		.group_id = ROOT_GROUP_ID,
 	},
 };
 STATIC_OBJECT(builtins);
@@ -84,12 +85,12 @@ Object *list_iter_next(TupleObject *args) {
 	if (args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)inner_args);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *result = call(method, inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	if (result == NULL) {
 		if (isinstance_inner(error, &g_IndexError)) {
-			error = exc_nil(&g_StopIteration);
+			error = exc_lazy_nil(&g_StopIteration);
 		}
 		return NULL;
 	}
@@ -119,7 +120,7 @@ Object *dict_getitem(TupleObject *args) {
 		return NULL;
 	}
 	if (!result.found) {
-		error = exc_arg(&g_KeyError, args->data[1]);
+		error = exc_lazy_arg(&g_KeyError, args->data[1]);
 		return NULL;
 	}
 	return (Object*)result.val;
@@ -136,16 +137,18 @@ Object *dict_setitem(TupleObject *args) {
 		return NULL;
 	}
 	DictObject *self = (DictObject*)args->data[0];
-	if (CURRENT_GROUP != self->header.group && !dict_get(&self->core, (void*)args->data[1], object_hasher, object_equals).found) {
+	if (CURRENT_GROUP != GROUP(self) && !dict_get(&self->core, (void*)args->data[1], object_hasher, object_equals).found) {
 		error = exc_msg(&g_RuntimeError, "Cannot allocate space in another group");
 		return NULL;
 	}
-	void *other_alloc(size_t size) { return quota_alloc(size, self->header.group); }
-	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, self->header.group); }
+	void *other_alloc(size_t size) { return quota_alloc(size, GROUP(self)); }
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
 
 	if (!dict_set(&self->core, (void*)args->data[1], (void*)args->data[2], object_hasher, object_equals, other_alloc, other_dealloc)) {
 		return NULL;
 	}
+	GC_WRITE(self, args->data[1]);
+	GC_WRITE(self, args->data[2]);
 	return (Object*)&g_none;
 }
 BUILTIN_METHOD(__setitem__, dict_setitem, dict);
@@ -160,14 +163,14 @@ Object *dict_popitem(TupleObject *args) {
 		return NULL;
 	}
 	DictObject *self = (DictObject*)args->data[0];
-	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, self->header.group); }
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
 
 	GetResult result = dict_pop(&self->core, (void*)args->data[1], object_hasher, object_equals, other_dealloc);
 	if (!result.success) {
 		return NULL;
 	}
 	if (!result.found) {
-		error = exc_arg(&g_KeyError, args->data[1]);
+		error = exc_lazy_arg(&g_KeyError, args->data[1]);
 		return NULL;
 	}
 	return (Object*)result.val;
@@ -261,7 +264,7 @@ Object *dict_str(TupleObject *args) {
 	if (converted == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)converted);
+	GC_TEMP_ROOT((Object*)converted);
 	size_t i = 0;
 	bool tracer(void *_key, void **_val) {
 		Object *key = (Object*)_key;
@@ -274,30 +277,30 @@ Object *dict_str(TupleObject *args) {
 		return true;
 	}
 	if (!dict_trace(&self->core, tracer)) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	TupleObject *inner_args = tuple_raw(NULL, 2);
 	if (inner_args == NULL) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	inner_args->data[0] = (Object*)bytes_unowned_raw(", ", 2, NULL);
 	if (inner_args->data[0] == NULL) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	inner_args->data[1] = (Object*)converted;
-	gc_unroot((Object*)converted);
-	gc_root((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)converted);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *joined_str = bytes_join(inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	if (joined_str == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)joined_str);
+	GC_TEMP_ROOT((Object*)joined_str);
 	Object *result = format_inner("{%s}", joined_str);
-	gc_unroot((Object*)joined_str);
+	GC_TEMP_UNROOT((Object*)joined_str);
 	return result;
 }
 BUILTIN_METHOD(__str__, dict_str, dict);
@@ -316,13 +319,7 @@ Object *bytes_eq(TupleObject *args) {
 		return (Object*)bool_raw(false);
 	}
 
-	BytesObject *self = (BytesObject*)args->data[0];
-	BytesObject *other = (BytesObject*)args->data[1];
-
-	if (self->len != other->len) {
-		return (Object*)bool_raw(false);
-	}
-	return (Object*)bool_raw(memcmp(bytes_data(self), bytes_data(other), self->len) == 0);
+	return (Object*)bool_raw(bytes_equals_raw((BytesObject*)args->data[0], (BytesObject*)args->data[1]));
 }
 BUILTIN_METHOD(__eq__, bytes_eq, bytes);
 BUILTIN_METHOD(__eq__, bytes_eq, bytearray);
@@ -341,14 +338,7 @@ Object *bytes_hash(TupleObject *args) {
 		return NULL;
 	}
 
-	BytesObject *self = (BytesObject*)args->data[0];
-	uint64_t result = 0xfedcba9876543210;
-	unsigned char *data = (unsigned char *)bytes_data(self);
-	for (size_t i = 0; i < self->len; i++) {
-		result += data[i];
-		result = (result << 23) | (result >> (64-23));
-	}
-	return (Object*)int_raw((int64_t)result);
+	return (Object*)int_raw((int64_t)bytes_hash_raw((BytesObject*)args->data[0]));
 }
 BUILTIN_METHOD(__hash__, bytes_hash, bytes);
 BUILTIN_METHOD(__hash__, bytes_hash, bytearray);
@@ -366,7 +356,7 @@ Object *bytes_getitem(TupleObject *args) {
 	if (isinstance_inner(args->data[1], &g_int)) {
 		size_t index = convert_index(self->len, ((IntObject*)args->data[1])->value);
 		if (index >= self->len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		return (Object*)int_raw((unsigned char)bytes_data(self)[index]);
@@ -390,7 +380,7 @@ Object *bytes_getitem(TupleObject *args) {
 			return NULL;
 		}
 		if (start > self->len || end > self->len || end < start) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		if (isinstance_inner((Object*)self, &g_bytearray)) {
@@ -428,7 +418,7 @@ Object *bytes_setitem(TupleObject *args) {
 	if (isinstance_inner(args->data[1], &g_int)) {
 		size_t index = convert_index(self->header_bytes.len, ((IntObject*)args->data[1])->value);
 		if (index >= self->header_bytes.len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		self->data[index] = value->value;
@@ -460,16 +450,16 @@ Object *bytes_push(TupleObject *args) {
 		error = exc_msg(&g_ValueError, "Expected int in range 0-255");
 		return NULL;
 	}
-	if (CURRENT_GROUP != self->header_bytes.header.group) {
+	if (CURRENT_GROUP != GROUP(self)) {
 		error = exc_msg(&g_RuntimeError, "Cannot allocate space in another group");
 		return NULL;
 	}
-	void *other_realloc(void * ptr, size_t newsize, size_t oldsize) { return quota_realloc(ptr, newsize, oldsize, self->header_bytes.header.group); }
+	void *other_realloc(void * ptr, size_t newsize, size_t oldsize) { return quota_realloc(ptr, newsize, oldsize, GROUP(self)); }
 	size_t index;
 	if (args->len == 3 && isinstance_inner(args->data[2], &g_int)) {
 		index = convert_index(self->header_bytes.len, ((IntObject*)args->data[1])->value);
 		if (index > self->header_bytes.len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 	} else if ((args->len == 3 && args->data[2] == (Object*)&g_none) || args->len == 2) {
@@ -510,7 +500,7 @@ Object *bytes_pop(TupleObject *args) {
 	if (args->len == 2 && isinstance_inner(args->data[1], &g_int)) {
 		index = convert_index(self->header_bytes.len, ((IntObject*)args->data[1])->value);
 		if (index >= self->header_bytes.len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 	} else if ((args->len == 2 && args->data[2] == (Object*)&g_none) || args->len == 1) {
@@ -519,7 +509,7 @@ Object *bytes_pop(TupleObject *args) {
 			if (the_int == NULL) {
 				return NULL;
 			}
-			error = exc_arg(&g_IndexError, the_int);
+			error = exc_lazy_arg(&g_IndexError, the_int);
 			return NULL;
 		}
 		index = self->header_bytes.len - 1;
@@ -555,11 +545,11 @@ Object *bytes_extend(TupleObject *args) {
 	}
 	BytearrayObject *self = (BytearrayObject*)args->data[0];
 	BytesObject *other = (BytesObject*)args->data[1];
-	if (CURRENT_GROUP != self->header_bytes.header.group) {
+	if (CURRENT_GROUP != GROUP(self)) {
 		error = exc_msg(&g_RuntimeError, "Cannot allocate space in another group");
 		return NULL;
 	}
-	void *other_realloc(void *ptr, size_t newsize, size_t oldsize) { return quota_realloc(ptr, newsize, oldsize, self->header_bytes.header.group); }
+	void *other_realloc(void *ptr, size_t newsize, size_t oldsize) { return quota_realloc(ptr, newsize, oldsize, GROUP(self)); }
 
 	size_t new_len = self->header_bytes.len + other->len;
 	if (new_len > self->cap) {
@@ -751,17 +741,11 @@ Object *tuple_hash(TupleObject *args) {
 		error = exc_msg(&g_TypeError, "Expected tuple");
 		return NULL;
 	}
-	TupleObject *self = (TupleObject*)args->data[0];
-	uint64_t hash = 0x0123456789abcdef;
-	for (size_t i = 0; i < self->len; i++) {
-		HashResult hashed = object_hasher(self->data[i]);
-		if (!hashed.success) {
-			return NULL;
-		}
-		hash += hashed.hash;
-		hash = (hash << 17) | (hash >> (64-17));
+	HashResult hashed = tuple_hash_raw((TupleObject*)args->data[0]);
+	if (!hashed.success) {
+		return NULL;
 	}
-	return (Object*)int_raw((int64_t)hash);
+	return (Object*)int_raw((int64_t)hashed.hash);
 }
 BUILTIN_METHOD(__hash__, tuple_hash, tuple);
 
@@ -773,19 +757,11 @@ Object *tuple_eq(TupleObject *args) {
 	if (!isinstance_inner(args->data[0], &g_tuple )|| !isinstance_inner(args->data[1], &g_tuple)) {
 		return (Object*)bool_raw(false);
 	}
-	TupleObject *self = (TupleObject*)args->data[0];
-	TupleObject *other = (TupleObject*)args->data[1];
-
-	for (size_t i = 0; i < self->len && i < other->len; i++) {
-		EqualityResult eq = object_equals(self->data[i], other->data[i]);
-		if (!eq.success) {
-			return NULL;
-		}
-		if (!eq.equals) {
-			return (Object*)bool_raw(false);
-		}
+	EqualityResult eq = tuple_equals_raw((TupleObject*)args->data[0], (TupleObject*)args->data[1]);
+	if (!eq.success) {
+		return NULL;
 	}
-	return (Object*)bool_raw(true);
+	return (Object*)bool_raw(eq.equals);
 }
 BUILTIN_METHOD(__eq__, tuple_eq, tuple);
 
@@ -802,7 +778,7 @@ Object *tuple_getitem(TupleObject *args) {
 	if (isinstance_inner(args->data[1], &g_int)) {
 		size_t index = convert_index(self->len, ((IntObject*)args->data[1])->value);
 		if (index >= self->len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		return self->data[index];
@@ -826,7 +802,7 @@ Object *tuple_getitem(TupleObject *args) {
 			return NULL;
 		}
 		if (start > self->len || end > self->len || end < start) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		return (Object*)tuple_raw_ex(self->data + start, end - start, self->header.type);
@@ -853,6 +829,7 @@ Object *tuple_add(TupleObject *args) {
 	TupleObject *result = tuple_raw_ex(NULL, self->len + other->len, self->header.type);
 	memcpy(result->data, self->data, sizeof(Object*) * self->len);
 	memcpy(result->data + self->len, other->data, sizeof(Object*) * other->len);
+	gc_write_all((Object*)result, result->data, result->len);
 	return (Object*)result;
 }
 BUILTIN_METHOD(__add__, tuple_add, tuple);
@@ -885,35 +862,36 @@ Object *tuple_str(TupleObject *args) {
 	if (converted == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)converted);
+	GC_TEMP_ROOT((Object*)converted);
 	for (size_t i = 0; i < self->len; i++) {
 		converted->data[i] = (Object*)bytes_constructor_inner(self->data[i]);
 		if (converted->data[i] == NULL) {
-			gc_unroot((Object*)converted);
+			GC_TEMP_UNROOT((Object*)converted);
 			return NULL;
 		}
+		GC_WRITE(converted, converted->data[i]);
 	}
 	TupleObject *inner_args = tuple_raw(NULL, 2);
 	if (inner_args == NULL) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	inner_args->data[0] = (Object*)bytes_unowned_raw(", ", 2, NULL);
 	if (inner_args->data[0] == NULL) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	inner_args->data[1] = (Object*)converted;
-	gc_unroot((Object*)converted);
-	gc_root((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)converted);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *joined_str = bytes_join(inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	if (joined_str == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)joined_str);
+	GC_TEMP_ROOT((Object*)joined_str);
 	Object *result = format_inner("[%s]", joined_str);
-	gc_unroot((Object*)joined_str);
+	GC_TEMP_UNROOT((Object*)joined_str);
 	return result;
 }
 BUILTIN_METHOD(__str__, tuple_str, tuple);
@@ -961,7 +939,7 @@ Object *list_getitem(TupleObject *args) {
 	if (isinstance_inner(args->data[1], &g_int)) {
 		size_t index = convert_index(self->len, ((IntObject*)args->data[1])->value);
 		if (index >= self->len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		return self->data[index];
@@ -985,7 +963,7 @@ Object *list_getitem(TupleObject *args) {
 			return NULL;
 		}
 		if (start > self->len || end > self->len || end < start) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		return (Object*)list_raw_ex(self->data + start, end - start, self->header.type);
@@ -1009,10 +987,11 @@ Object *list_setitem(TupleObject *args) {
 	if (isinstance_inner(args->data[1], &g_int)) {
 		size_t index = convert_index(self->len, ((IntObject*)args->data[1])->value);
 		if (index >= self->len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 		self->data[index] = args->data[2];
+		GC_WRITE(self, args->data[2]);
 		return (Object*)&g_none;
 	} else {
 		// TODO slices
@@ -1032,16 +1011,16 @@ Object *list_push(TupleObject *args) {
 		return NULL;
 	}
 	ListObject *self = (ListObject*)args->data[0];
-	if (CURRENT_GROUP != self->header.group) {
+	if (CURRENT_GROUP != GROUP(self)) {
 		error = exc_msg(&g_RuntimeError, "Cannot allocate space in another group");
 		return NULL;
 	}
-	void *other_realloc(void * ptr, size_t newsize, size_t oldsize) { return quota_realloc(ptr, newsize, oldsize, self->header.group); }
+	void *other_realloc(void * ptr, size_t newsize, size_t oldsize) { return quota_realloc(ptr, newsize, oldsize, GROUP(self)); }
 	size_t index;
 	if (args->len == 3 && isinstance_inner(args->data[2], &g_int)) {
 		index = convert_index(self->len, ((IntObject*)args->data[1])->value);
 		if (index > self->len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 	} else if ((args->len == 3 && args->data[2] == (Object*)&g_none) || args->len == 2) {
@@ -1064,6 +1043,7 @@ Object *list_push(TupleObject *args) {
 	memmove(&self->data[index], &self->data[index + 1], sizeof(Object*) * (self->len - index));
 	self->data[index] = args->data[1];
 	self->len++;
+	GC_WRITE(self, args->data[1]);
 	return (Object*)&g_none;
 }
 BUILTIN_METHOD(push, list_push, list);
@@ -1074,9 +1054,9 @@ bool list_push_back_inner(ListObject *self, Object *item) {
 	if (inner_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)inner_args);
+	GC_TEMP_ROOT((Object*)inner_args);
 	bool result = list_push(inner_args) != NULL;
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	return result;
 }
 
@@ -1094,7 +1074,7 @@ Object *list_pop(TupleObject *args) {
 	if (args->len == 2 && isinstance_inner(args->data[1], &g_int)) {
 		index = convert_index(self->len, ((IntObject*)args->data[1])->value);
 		if (index >= self->len) {
-			error = exc_arg(&g_IndexError, args->data[1]);
+			error = exc_lazy_arg(&g_IndexError, args->data[1]);
 			return NULL;
 		}
 	} else if ((args->len == 2 && args->data[2] == (Object*)&g_none) || args->len == 1) {
@@ -1103,7 +1083,7 @@ Object *list_pop(TupleObject *args) {
 			if (the_int == NULL) {
 				return NULL;
 			}
-			error = exc_arg(&g_IndexError, the_int);
+			error = exc_lazy_arg(&g_IndexError, the_int);
 			return NULL;
 		}
 		index = self->len - 1;
@@ -1124,9 +1104,9 @@ Object *list_pop_back_inner(ListObject *self) {
 	if (inner_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)inner_args);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *result = list_pop(inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	return result;
 }
 
@@ -1159,35 +1139,36 @@ Object *list_str(TupleObject *args) {
 	if (converted == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)converted);
+	GC_TEMP_ROOT((Object*)converted);
 	for (size_t i = 0; i < self->len; i++) {
 		converted->data[i] = (Object*)bytes_constructor_inner(self->data[i]);
 		if (converted->data[i] == NULL) {
-			gc_unroot((Object*)converted);
+			GC_TEMP_UNROOT((Object*)converted);
 			return NULL;
 		}
+		GC_WRITE(converted, converted->data[i]);
 	}
 	TupleObject *inner_args = tuple_raw(NULL, 2);
 	if (inner_args == NULL) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	inner_args->data[0] = (Object*)bytes_unowned_raw(", ", 2, NULL);
 	if (inner_args->data[0] == NULL) {
-		gc_unroot((Object*)converted);
+		GC_TEMP_UNROOT((Object*)converted);
 		return NULL;
 	}
 	inner_args->data[1] = (Object*)converted;
-	gc_unroot((Object*)converted);
-	gc_root((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)converted);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *joined_str = bytes_join(inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	if (joined_str == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)joined_str);
+	GC_TEMP_ROOT((Object*)joined_str);
 	Object *result = format_inner("list([%s])", joined_str);
-	gc_unroot((Object*)joined_str);
+	GC_TEMP_UNROOT((Object*)joined_str);
 	return result;
 }
 BUILTIN_METHOD(__str__, list_str, list);
@@ -1727,9 +1708,9 @@ Object *object_ne(TupleObject *args) {
 	if (new_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)new_args);
+	GC_TEMP_ROOT((Object*)new_args);
 	Object *is_eq = call(eq, new_args);
-	gc_unroot((Object*)new_args);
+	GC_TEMP_UNROOT((Object*)new_args);
 	if (is_eq == NULL) {
 		return NULL;
 	}
@@ -1741,9 +1722,9 @@ Object *object_ne(TupleObject *args) {
 	if (new_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)new_args);
+	GC_TEMP_ROOT((Object*)new_args);
 	Object *result = call(not, new_args);
-	gc_unroot((Object*)new_args);
+	GC_TEMP_UNROOT((Object*)new_args);
 	return result;
 }
 BUILTIN_METHOD(__ne__, object_ne, object);
@@ -1809,9 +1790,10 @@ Object *object_iter(TupleObject *args) {
 		return NULL;
 	}
 	result->header.type = &g_list_iterator;
-	result->header.table = &list_iterator_table;
+	result->header.table_id = TABLE_LIST_ITERATOR;
 	result->child = args->data[0];
 	result->next_index = 0;
+	GC_WRITE(result, result->child);
 	return (Object*)result;
 }
 BUILTIN_METHOD(__iter__, object_iter, object);
@@ -1834,15 +1816,15 @@ Object *exc_str(TupleObject *args) {
 	if (inner_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)inner_args);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *inner_repr = tuple_str(inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	if (inner_repr == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)inner_repr);
+	GC_TEMP_ROOT((Object*)inner_repr);
 	Object *result = format_inner("Exception%s", inner_repr);
-	gc_unroot((Object*)inner_repr);
+	GC_TEMP_UNROOT((Object*)inner_repr);
 	return result;
 }
 BUILTIN_METHOD(__str__, exc_str, exception);
@@ -1902,7 +1884,7 @@ Object *thread_next(TupleObject *args) {
 		return self->result;
 	}
 	if (self->status == RETURNED) {
-		error = exc_nil(&g_StopIteration);
+		error = exc_lazy_nil(&g_StopIteration);
 		return NULL;
 	}
 	if (self->status == EXCEPTED) {
@@ -1973,6 +1955,7 @@ Object *thread_inject(TupleObject *args) {
 
 	ThreadObject *self = (ThreadObject*)args->data[0];
 	self->injected = (ExceptionObject*)args->data[1];
+	GC_WRITE(self, self->injected);
 	return (Object*)&g_none;
 }
 BUILTIN_METHOD(inject, thread_inject, thread);
@@ -2001,7 +1984,7 @@ Object *threadgroup_donate(TupleObject *args) {
 		error = exc_msg(&g_TypeError, "Do NOT make me think about what this would do @_@");
 		return NULL;
 	}
-	if (CURRENT_GROUP != args->data[1]->group) {
+	if (CURRENT_GROUP != GROUP(args->data[1])) {
 		error = exc_msg(&g_ValueError, "You can't donate an object you don't own!");
 		return false;
 	}
@@ -2019,9 +2002,10 @@ bool donate_inner(ThreadGroupObject *new_group, Object *obj) {
 	}
 
 	// lord have mercy
-	obj->group->mem_used -= the_size;
+	gc_donating(obj);
+	GROUP(obj)->mem_used -= the_size;
 	new_group->mem_used += the_size;
-	obj->group = new_group;
+	obj->group_id = new_group->id;
 	return true;
 }
 
@@ -2041,6 +2025,7 @@ Object *threadgroup_inject(TupleObject *args) {
 
 	ThreadGroupObject *self = (ThreadGroupObject*)args->data[0];
 	self->injected = (ExceptionObject*)args->data[1];
+	GC_WRITE(self, self->injected);
 	return (Object*)&g_none;
 }
 BUILTIN_METHOD(inject, threadgroup_inject, threadgroup);
@@ -2079,6 +2064,124 @@ Object *threadgroup_spawn_donated(TupleObject *args) {
 }
 BUILTIN_METHOD(spawn_donated, threadgroup_spawn_donated, threadgroup);
 
+/////////////////////////////////////
+/// gc functions
+/////////////////////////////////////
+
+BasicObject g_gc = {
+	.header_dict.header = {
+		.table_id = TABLE_OBJECT,
+		.type = &g_object,
+		.group_id = ROOT_GROUP_ID,
+	},
+};
+STATIC_OBJECT(g_gc);
+ADD_MEMBER(builtins, "gc", g_gc);
+
+Object *gc_collect_builtin(TupleObject *args) {
+	if (args->len != 0) {
+		error = exc_msg(&g_TypeError, "Expected 0 arguments");
+		return NULL;
+	}
+	// we got here through a call, which is as good a place to collect as gc_probe
+	gc_collect();
+	gc_finish_sweep();
+	return (Object*)&g_none;
+}
+BUILTIN_METHOD(collect, gc_collect_builtin, gc);
+
+// a dict of gc_stats, plus "types", type -> live objects, and "groups", threadgroup id -> mem_used
+Object *gc_stats_builtin(TupleObject *args) {
+	if (args->len != 0) {
+		error = exc_msg(&g_TypeError, "Expected 0 arguments");
+		return NULL;
+	}
+	DictCore counts = {0};
+	if (!gc_count_types(&counts)) {
+		dict_destruct(&counts, global_dealloc);
+		return NULL;
+	}
+
+	DictObject *result = dicto_raw(), *types = NULL, *groups = NULL;
+	if (result == NULL) {
+		dict_destruct(&counts, global_dealloc);
+		return NULL;
+	}
+	GC_TEMP_ROOT((Object*)result);
+	bool put(DictObject *dict, Object *key, Object *val) {
+		if (key == NULL || val == NULL || !dict_set(&dict->core, key, val, object_hasher, object_equals, current_thread_alloc, current_thread_dealloc)) {
+			return false;
+		}
+		GC_WRITE(dict, key);
+		GC_WRITE(dict, val);
+		return true;
+	}
+	bool put_stat(char *name, uint64_t val) {
+		return put(result, (Object*)bytes_unowned_raw(name, strlen(name), NULL), (Object*)int_raw(val));
+	}
+	bool put_type(void *key, void **val) {
+		return put(types, (Object*)key, (Object*)int_raw((uintptr_t)*val));
+	}
+	bool put_group(ThreadGroupObject *group) {
+		// by id, so that looking doesn't hand out other groups to inject into or keep them alive
+		return put(groups, (Object*)int_raw(group->id), (Object*)int_raw(group->mem_used));
+	}
+	bool ok = put(result, (Object*)bytes_unowned_raw("types", 5, NULL), (Object*)(types = dicto_raw()))
+		&& put(result, (Object*)bytes_unowned_raw("groups", 6, NULL), (Object*)(groups = dicto_raw()))
+		&& dict_trace(&counts, put_type)
+		&& gc_walk_groups(put_group)
+		&& put_stat("collections", gc_stats.collections)
+		&& put_stat("group_collections", gc_stats.group_collections)
+		&& put_stat("pause_ns", gc_stats.pause_ns)
+		&& put_stat("max_pause_ns", gc_stats.max_pause_ns)
+		&& put_stat("bytes_allocated", gc_stats.bytes_allocated)
+		&& put_stat("bytes_freed", gc_stats.bytes_freed)
+		&& put_stat("objects_freed", gc_stats.objects_freed)
+		&& put_stat("live_bytes", gc_stats.live_bytes)
+		&& put_stat("mapped_bytes", gc_stats.mapped_bytes)
+		&& put_stat("bytes_returned", gc_stats.bytes_returned);
+	GC_TEMP_UNROOT((Object*)result);
+	dict_destruct(&counts, global_dealloc);
+	return ok ? (Object*)result : NULL;
+}
+BUILTIN_METHOD(stats, gc_stats_builtin, gc);
+
+Object *gc_dump_builtin(TupleObject *args) {
+	if (args->len != 1) {
+		error = exc_msg(&g_TypeError, "Expected 1 argument");
+		return NULL;
+	}
+	if (!isinstance_inner(args->data[0], &g_bytes)) {
+		error = exc_msg(&g_TypeError, "Expected bytes");
+		return NULL;
+	}
+	BytesObject *path = (BytesObject*)args->data[0];
+	if (memchr(bytes_data(path), '\0', path->len) != NULL) {
+		error = exc_msg(&g_ValueError, "Embedded null byte");
+		return NULL;
+	}
+	char *cpath = alloca(path->len + 1);
+	memcpy(cpath, bytes_data(path), path->len);
+	cpath[path->len] = 0;
+
+	FILE *fp = fopen(cpath, "wb");
+	if (fp == NULL) {
+		error = exc_msg(&g_OSError, strerror(errno));
+		return NULL;
+	}
+	// collects, like gc.collect
+	bool ok = gc_dump(fp);
+	if (fclose(fp) != 0) {
+		ok = false;
+	}
+	if (!ok) {
+		error = exc_msg(&g_OSError, "Could not write heap dump");
+		return NULL;
+	}
+	return (Object*)&g_none;
+}
+BUILTIN_METHOD(dump, gc_dump_builtin, gc);
+
 /////////////////////////////////////
 /// freestanding functions
 /////////////////////////////////////
@@ -2093,6 +2196,7 @@ Object *builtin_format(TupleObject *args) {
 		if (converted_args->data[i] == NULL) {
 			return NULL;
 		}
+		GC_WRITE(converted_args, converted_args->data[i]);
 	}
 	BytesObject *empty_string = bytes_raw(NULL, 0);
 	if (empty_string == NULL) { return NULL; }
@@ -2162,6 +2266,7 @@ Object *format_inner(const char *format, ...) {
 			i++;
 			if (*i != '%') {
 				inner_args->data[idx] = va_arg(ap, Object*);
+				GC_WRITE(inner_args, inner_args->data[idx]);
 				idx++;
 			} else {
 				const_start = i;
@@ -2184,9 +2289,9 @@ Object *format_inner(const char *format, ...) {
 		exit(1);
 	}
 
-	gc_root((Object*)inner_args);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *result = builtin_format(inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	return result;
 }
 
@@ -2220,12 +2325,27 @@ Object *builtin_isinstance(TupleObject *args) {
 BUILTIN_FUNCTION(isinstance, builtin_isinstance);
 
 bool isinstance_inner(Object *obj, TypeObject *type) {
-	for (TypeObject *ptype = obj->type; ptype; ptype = ptype->base_class) {
-		if (type == ptype) {
-			return true;
-		}
+	TypeObject *ptype = obj->type;
+	if (ptype == type) {
+		return true;
+	}
+	if (ptype->display_len == 0) {
+		type_display_init(ptype);
+	}
+	if (type->display_len == 0) {
+		type_display_init(type);
+	}
+	size_t depth = type->display_len - 1;
+	if (depth >= ptype->display_len) {
+		return false;
+	}
+	if (depth < TYPE_DISPLAY_MAX) {
+		return ptype->display[depth] == type;
+	}
+	for (size_t i = ptype->display_len - 1; i > depth; i--) {
+		ptype = ptype->base_class;
 	}
-	return false;
+	return ptype == type;
 }
 
 Object *builtin_chr(TupleObject *args) {
@@ -15,6 +15,10 @@ bool list_push_back_inner(ListObject *self, Object *item);
 Object *dict_getitem(TupleObject *args);
 Object *dict_setitem(TupleObject *args);
 Object *dict_popitem(TupleObject *args);
+Object *dict_delitem(TupleObject *args);
+Object *dict_eq(TupleObject *args);
+Object *dict_bool(TupleObject *args);
+Object *dict_str(TupleObject *args);
 
 Object *format_inner(const char *format, ...);
 Object *bytes_join(TupleObject *args);
@@ -27,8 +31,8 @@ bool donate_inner(ThreadGroupObject *new_group, Object *obj);
 BuiltinFunctionObject g_##cls##_##name = { \
 	.header = { \
 		.type = &g_builtin, \
-		.table = &builtinfunction_table, \
-		.group = &root_threadgroup, \
+		.table_id = TABLE_BUILTINFUNCTION, \
+		.group_id = ROOT_GROUP_ID, \
 	}, \
 	.func = function, \
 }; \
@@ -39,8 +43,8 @@ ADD_MEMBER(g_##cls, #name, g_##cls##_##name)
 BuiltinFunctionObject g_##name = { \
 	.header = { \
 		.type = &g_builtin, \
-		.table = &builtinfunction_table, \
-		.group = &root_threadgroup, \
+		.table_id = TABLE_BUILTINFUNCTION, \
+		.group_id = ROOT_GROUP_ID, \
 	}, \
 	.func = function, \
 }; \
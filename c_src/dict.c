@@ -2,182 +2,363 @@
 #include "errors.h"
 
 #include <stdbool.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// every index slot has a control byte. a full slot's holds the top 7 bits of its key's hash, so
+// most slots which can't hold the key are skipped without calling equality_func, and the entry has
+// the rest of the hash for the ones which get past that. hash_func is only ever called on the key
+// being looked for: resizing moves entries by their stored hashes. the control bytes are looked at
+// a group of DICT_GROUP at a time, and a key is found in the first group on its probe sequence with
+// room, unless that was taken by the time it got there.
+//
+// a deleted entry leaves a hole, with a NULL key, until the next resize packs the entries again.
+//
+// growing past DICT_INCREMENTAL_CAP moves the entries over DICT_REHASH_STEP at a time instead of
+// all at once, so no single insert stalls every thread on a huge table. they keep their positions,
+// so the order holds, and the holes are left for a later resize. until the last one is moved,
+// lookups which miss the new index try the old one.
+#define DICT_GROUP 16
+#define DICT_MIN_CAP 4
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+#define CTRL_PADDING 0xff // fills out an index smaller than a group. matches nothing
+#define DICT_INCREMENTAL_CAP 0x10000
+#define DICT_REHASH_STEP 128
 
 typedef struct LookupResult {
-	// tagged union. contents have meaning if found_any is set; is_first switches fields
-	union {
-		DictChain *foundFirst;
-		DictChain **foundNext;
-	} found;
-	bool found_any;
-	bool is_first;
+	DictCore *table; // the dict, or the table it's moving out of
+	size_t slot;  // in the table's index, if found
+	size_t entry; // which the slot points to
+	bool found;
 	bool success;
 } LookupResult;
 
-void dict_destruct(DictCore *dict, dealloc_t dealloc) {
-	if (!dict->buckets) {
-		return;
+// leave an eighth of the slots empty, so probes find the end of their sequence quickly. this is
+// also how many entries there is room for
+size_t dict_max_load(size_t cap) {
+	return cap - cap / 8;
+}
+
+size_t dict_ctrl_len(size_t cap) {
+	return cap < DICT_GROUP ? DICT_GROUP : cap;
+}
+
+// bytes per index slot. small dicts are the common case, so they get small indices
+size_t dict_index_width(size_t cap) {
+	return cap <= 0x100 ? 1 : cap <= 0x10000 ? 2 : 4;
+}
+
+size_t dict_table_bytes(size_t cap) {
+	return sizeof(DictEntry) * dict_max_load(cap) + dict_ctrl_len(cap) + dict_index_width(cap) * cap;
+}
+
+uint8_t *dict_ctrl(DictCore *dict) {
+	return (uint8_t*)(dict->entries + dict_max_load(dict->cap));
+}
+
+size_t dict_index_get(DictCore *dict, size_t slot) {
+	void *index = dict_ctrl(dict) + dict_ctrl_len(dict->cap);
+	switch (dict_index_width(dict->cap)) {
+		case 1: return ((uint8_t*)index)[slot];
+		case 2: return ((uint16_t*)index)[slot];
+		default: return ((uint32_t*)index)[slot];
 	}
-	for (size_t bucket = 0; bucket < dict->cap; bucket++) {
-		DictChain *next;
-		while ((next = dict->buckets[bucket].next)) {
-			dict->buckets[bucket].next = next->next;
-			dealloc(next, sizeof(DictChain));
+}
+
+void dict_index_set(DictCore *dict, size_t slot, size_t entry) {
+	void *index = dict_ctrl(dict) + dict_ctrl_len(dict->cap);
+	switch (dict_index_width(dict->cap)) {
+		case 1: ((uint8_t*)index)[slot] = entry; break;
+		case 2: ((uint16_t*)index)[slot] = entry; break;
+		default: ((uint32_t*)index)[slot] = entry; break;
+	}
+}
+
+// the low bits pick the first group and the high bits go in the control byte, so both have to
+// depend on the whole hash
+uint64_t dict_mix(uint64_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+uint8_t dict_tag(uint64_t mixed) {
+	return mixed >> 57;
+}
+
+// a bit for each control byte in the group which equals byte
+uint32_t dict_match(uint8_t *group, uint8_t byte) {
+#ifdef __SSE2__
+	__m128i ctrl = _mm_loadu_si128((__m128i*)group);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+	uint32_t result = 0;
+	for (int i = 0; i < DICT_GROUP; i++) {
+		if (group[i] == byte) {
+			result |= 1u << i;
+		}
+	}
+	return result;
+#endif
+}
+
+// the groups are visited in triangular steps, which reaches all of them since there's a power of two
+size_t dict_group_mask(DictCore *dict) {
+	return (dict->cap < DICT_GROUP ? 1 : dict->cap / DICT_GROUP) - 1;
+}
+
+// look for the key among the entries from `from` on, or if equality_func is NULL, for the slot
+// pointing at entry `want`
+LookupResult dict_lookup(DictCore *dict, void *key, uint64_t mixed, equality_func_t equality_func, size_t from, size_t want) {
+	LookupResult result = {
+		.found = false,
+		.success = true,
+	};
+	if (dict->cap == 0) {
+		return result;
+	}
+	size_t mask = dict_group_mask(dict);
+	size_t group = mixed & mask;
+	for (size_t step = 1; step <= mask + 1; step++) {
+		uint8_t *ctrl = dict_ctrl(dict) + group * DICT_GROUP;
+		for (uint32_t bits = dict_match(ctrl, dict_tag(mixed)); bits; bits &= bits - 1) {
+			size_t slot = group * DICT_GROUP + __builtin_ctz(bits);
+			size_t entry = dict_index_get(dict, slot);
+			if (equality_func == NULL) {
+				if (entry != want) {
+					continue;
+				}
+			} else {
+				if (entry < from || dict->entries[entry].hash != mixed) {
+					continue;
+				}
+				EqualityResult eq = equality_func(key, dict->entries[entry].key);
+				if (!eq.success) {
+					result.success = false;
+					return result;
+				}
+				if (!eq.equals) {
+					continue;
+				}
+			}
+			result.table = dict;
+			result.slot = slot;
+			result.entry = entry;
+			result.found = true;
+			return result;
 		}
+		if (dict_match(ctrl, CTRL_EMPTY)) {
+			return result;
+		}
+		group = (group + step) & mask;
 	}
-	dealloc(dict->buckets, sizeof(DictChain) * dict->cap);
-	dict->buckets = NULL;
+	return result;
+}
+
+// which table entry i is in right now
+DictCore *dict_table_of(DictCore *dict, size_t i) {
+	DictRehash *rehash = dict->rehash;
+	return rehash != NULL && i >= rehash->pos && i < rehash->old.used ? &rehash->old : dict;
+}
+
+// look in the table being moved out of too. the old index still points at the entries which
+// have been moved, but those are the new index's business now. nothing traces them there, so
+// their keys may be long dead and mustn't even be compared against
+LookupResult dict_find(DictCore *dict, void *key, uint64_t mixed, equality_func_t equality_func) {
+	LookupResult result = dict_lookup(dict, key, mixed, equality_func, 0, 0);
+	if (result.found || !result.success || dict->rehash == NULL) {
+		return result;
+	}
+	return dict_lookup(&dict->rehash->old, key, mixed, equality_func, dict->rehash->pos, 0);
+}
+
+// the first empty or deleted slot on the probe sequence. there always is one below the max load
+size_t dict_find_free(DictCore *dict, uint64_t mixed) {
+	size_t mask = dict_group_mask(dict);
+	size_t group = mixed & mask;
+	for (size_t step = 1; ; step++) {
+		uint8_t *ctrl = dict_ctrl(dict) + group * DICT_GROUP;
+		uint32_t bits = dict_match(ctrl, CTRL_EMPTY) | dict_match(ctrl, CTRL_DELETED);
+		if (bits) {
+			return group * DICT_GROUP + __builtin_ctz(bits);
+		}
+		group = (group + step) & mask;
+	}
+}
+
+void dict_index_insert(DictCore *dict, size_t entry, uint64_t mixed) {
+	size_t slot = dict_find_free(dict, mixed);
+	dict_ctrl(dict)[slot] = dict_tag(mixed);
+	dict_index_set(dict, slot, entry);
+}
+
+// append an entry. there has to be room for it
+void dict_append(DictCore *dict, void *key, void *val, uint64_t mixed) {
+	dict_index_insert(dict, dict->used, mixed);
+	dict->entries[dict->used].hash = mixed;
+	dict->entries[dict->used].key = key;
+	dict->entries[dict->used].val = val;
+	dict->used++;
+	dict->len++;
+}
+
+void dict_erase(DictCore *dict, LookupResult *lookup) {
+	DictCore *table = lookup->table;
+	uint8_t *ctrl = dict_ctrl(table);
+	// a probe only goes on past a group with no empty slots. if this group has one, none did
+	ctrl[lookup->slot] = dict_match(ctrl + lookup->slot / DICT_GROUP * DICT_GROUP, CTRL_EMPTY) ? CTRL_EMPTY : CTRL_DELETED;
+	table->entries[lookup->entry].key = NULL;
+	table->entries[lookup->entry].val = NULL;
+	if (table == dict && lookup->entry == dict->used - 1) {
+		dict->used--;
+	}
+	dict->len--;
+	dict->generation++;
+}
+
+void dict_destruct(DictCore *dict, dealloc_t dealloc) {
+	if (dict->rehash) {
+		dict_destruct(&dict->rehash->old, dealloc);
+		dealloc(dict->rehash, sizeof(DictRehash));
+		dict->rehash = NULL;
+	}
+	if (!dict->entries) {
+		return;
+	}
+	dealloc(dict->entries, dict_table_bytes(dict->cap));
+	dict->entries = NULL;
 	dict->cap = 0;
 	dict->len = 0;
+	dict->used = 0;
 }
 
 void dict_construct(DictCore *dict) {
 	dict->len = 0;
 	dict->cap = 0;
-	dict->buckets = NULL;
+	dict->used = 0;
+	dict->entries = NULL;
+	dict->rehash = NULL;
 }
 
-LookupResult dict_lookup(DictCore *dict, void *key, hash_func_t hash_func, equality_func_t equality_func) {
-	HashResult hash = hash_func(key);
-	if (!hash.success) {
-		return (LookupResult) {
-			.found_any = false,
-			.is_first = false,
-			.success = false,
-		};
+// move up to count more entries into the new table, and drop the old one once they all are
+void dict_rehash_step(DictCore *dict, size_t count, dealloc_t dealloc) {
+	DictRehash *rehash = dict->rehash;
+	for (; count && rehash->pos < rehash->old.used; count--, rehash->pos++) {
+		DictEntry *entry = &rehash->old.entries[rehash->pos];
+		dict->entries[rehash->pos] = *entry;
+		if (entry->key != NULL) {
+			dict_index_insert(dict, rehash->pos, entry->hash);
+		}
 	}
-
-	if (dict->cap == 0) {
-		return (LookupResult) {
-			.found_any = false,
-			.is_first = false,
-			.success = true,
-		};
+	if (rehash->pos == rehash->old.used) {
+		dict->rehash = NULL;
+		dict_destruct(&rehash->old, dealloc);
+		dealloc(rehash, sizeof(DictRehash));
 	}
+}
 
-	size_t bucket = hash.hash % dict->cap;
-	if (dict->buckets[bucket].key) {
-		EqualityResult eq = equality_func(key, dict->buckets[bucket].key);
-		if (!eq.success) {
-			return (LookupResult) {
-				.found_any = false,
-				.is_first = false,
-				.success = false,
-			};
-		}
-		if (eq.equals) {
-			return (LookupResult) {
-				.found.foundFirst = &dict->buckets[bucket],
-				.found_any = true,
-				.is_first = true,
-				.success = true,
-			};
-		}
-		for (DictChain **next = &dict->buckets[bucket].next; *next; next = &(*next)->next) {
-			eq = equality_func(key, (*next)->key);
-			if (!eq.success) {
-				return (LookupResult) {
-					.found_any = false,
-					.is_first = false,
-					.success = false,
-				};
-			}
-			if (eq.equals) {
-				return (LookupResult) {
-					.found.foundNext = next,
-					.found_any = true,
-					.is_first = false,
-					.success = true,
-				};
-			}
-		}
+bool dict_alloc_table(DictCore *table, size_t cap, alloc_t alloc) {
+	table->cap = cap;
+	table->entries = alloc(dict_table_bytes(cap));
+	if (!table->entries) {
+		error = (Object*)&MemoryError_inst;
+		return false;
 	}
+	memset(dict_ctrl(table), CTRL_EMPTY, cap);
+	memset(dict_ctrl(table) + cap, CTRL_PADDING, dict_ctrl_len(cap) - cap);
+	return true;
+}
 
-	return (LookupResult) {
-		.found_any = false,
-		.is_first = false,
-		.success = true,
-	};
+// start moving into a table of the given size. the entries keep their positions, holes and all,
+// so there has to be room for every one of them
+bool dict_grow_incremental(DictCore *dict, size_t cap, alloc_t alloc, dealloc_t dealloc) {
+	DictCore temp;
+	dict_construct(&temp);
+	if (!dict_alloc_table(&temp, cap, alloc)) {
+		return false;
+	}
+	DictRehash *rehash = alloc(sizeof(DictRehash));
+	if (!rehash) {
+		dict_destruct(&temp, dealloc);
+		error = (Object*)&MemoryError_inst;
+		return false;
+	}
+	rehash->old = *dict;
+	rehash->pos = 0;
+	temp.len = dict->len;
+	temp.used = dict->used;
+	temp.generation = dict->generation;
+	temp.rehash = rehash;
+	*dict = temp;
+	return true;
 }
 
-bool dict_expand(DictCore *dict, hash_func_t hash_func, alloc_t alloc, dealloc_t dealloc) {
+// move the entries into a table of the given size, packing out the holes
+bool dict_resize(DictCore *dict, size_t cap, alloc_t alloc, dealloc_t dealloc) {
 	DictCore temp;
 	dict_construct(&temp);
-	temp.cap = dict->cap * 2 + 3;
-	temp.buckets = alloc(sizeof(DictChain) * temp.cap);
-	if (!temp.buckets) {
+	temp.generation = dict->generation;
+	if (!dict_alloc_table(&temp, cap, alloc)) {
 		return false;
 	}
 
-	for (size_t bucket = 0; bucket < dict->cap; bucket++) {
-		for (DictChain *cur = &dict->buckets[bucket]; cur && cur->key; cur = cur->next) {
-			if (!dict_set(&temp, cur->key, cur->val, hash_func, NULL, alloc, dealloc)) {
-				dict_destruct(&temp, dealloc);
-				return false;
-			}
+	for (size_t i = 0; i < dict->used; i++) {
+		DictEntry *entry = &dict->entries[i];
+		if (entry->key != NULL) {
+			dict_append(&temp, entry->key, entry->val, entry->hash);
 		}
 	}
 
-	// who needs c++?
 	dict_destruct(dict, dealloc);
 	*dict = temp;
 	return true;
 }
 
 bool dict_set(DictCore *dict, void *key, void *val, hash_func_t hash_func, equality_func_t equality_func, alloc_t alloc, dealloc_t dealloc) {
-	if (dict->len >= dict->cap) {
-		if (!dict_expand(dict, hash_func, alloc, dealloc)) {
-			return false;
-		}
+	HashResult hash = hash_func(key);
+	if (!hash.success) {
+		return false;
 	}
+	uint64_t mixed = dict_mix(hash.hash);
 
 	if (equality_func != NULL) {
-		LookupResult lookup = dict_lookup(dict, key, hash_func, equality_func);
+		LookupResult lookup = dict_find(dict, key, mixed, equality_func);
 		if (!lookup.success) {
 			return false;
 		}
-		if (lookup.found_any) {
-			if (lookup.is_first) {
-				lookup.found.foundFirst->key = key;
-				lookup.found.foundFirst->val = val;
-			} else {
-				(*lookup.found.foundNext)->key = key;
-				(*lookup.found.foundNext)->val = val;
-			}
+		if (lookup.found) {
+			lookup.table->entries[lookup.entry].key = key;
+			lookup.table->entries[lookup.entry].val = val;
 			return true;
 		}
 	}
 
-	HashResult hash = hash_func(key);
-	if (!hash.success) {
-		return false;
-	}
-	size_t bucket = hash.hash % dict->cap;
-	if (!dict->buckets[bucket].key) {
-		dict->buckets[bucket].key = key;
-		dict->buckets[bucket].val = val;
-		dict->len++;
-		dict->generation++;
-		return true;
+	// only inserting and popping move entries along, since they bump the generation anyway
+	if (dict->rehash) {
+		dict_rehash_step(dict, DICT_REHASH_STEP, dealloc);
 	}
-
-	DictChain **link;
-	for (link = &dict->buckets[bucket].next; *link; link = &(*link)->next);
-	*link = alloc(sizeof(DictChain));
-	if (!*link) {
-		error = (Object*)&MemoryError_inst;
-		return false;
+	if (dict->used >= dict_max_load(dict->cap)) {
+		if (dict->rehash) {
+			dict_rehash_step(dict, SIZE_MAX, dealloc);
+		}
+		// if it's mostly holes, packing them out makes enough room
+		size_t cap = dict->cap == 0 ? DICT_MIN_CAP : dict->len >= dict_max_load(dict->cap) / 2 ? dict->cap * 2 : dict->cap;
+		if (cap > dict->cap && cap >= DICT_INCREMENTAL_CAP ? !dict_grow_incremental(dict, cap, alloc, dealloc) : !dict_resize(dict, cap, alloc, dealloc)) {
+			return false;
+		}
 	}
-	(*link)->key = key;
-	(*link)->val = val;
-	(*link)->next = NULL;
-	dict->len++;
+	dict_append(dict, key, val, mixed);
 	dict->generation++;
 	return true;
 }
 
 GetResult dict_get(DictCore *dict, void *key, hash_func_t hash_func, equality_func_t equality_func) {
-	LookupResult lookup = dict_lookup(dict, key, hash_func, equality_func);
+	HashResult hash = hash_func(key);
+	LookupResult lookup = hash.success ? dict_find(dict, key, dict_mix(hash.hash), equality_func) : (LookupResult) { .success = false };
 	if (!lookup.success) {
 		return (GetResult) {
 			.val = NULL,
@@ -185,7 +366,7 @@ GetResult dict_get(DictCore *dict, void *key, hash_func_t hash_func, equality_fu
 			.success = false,
 		};
 	}
-	if (!lookup.found_any) {
+	if (!lookup.found) {
 		return (GetResult) {
 			.val = NULL,
 			.found = false,
@@ -193,59 +374,15 @@ GetResult dict_get(DictCore *dict, void *key, hash_func_t hash_func, equality_fu
 		};
 	}
 	return (GetResult) {
-		.val = lookup.is_first ? lookup.found.foundFirst->val : (*lookup.found.foundNext)->val,
+		.val = lookup.table->entries[lookup.entry].val,
 		.found = true,
 		.success = true,
 	};
 }
 
-void lookup_pop(LookupResult *lookup, dealloc_t dealloc) {
-	if (lookup->is_first) {
-		if (lookup->found.foundFirst->next) {
-			DictChain *save = lookup->found.foundFirst->next;
-			*lookup->found.foundFirst = *save;
-			dealloc(save, sizeof(DictChain));
-		} else {
-			lookup->found.foundFirst->key = NULL;
-			lookup->found.foundFirst->val = NULL;
-			lookup->found_any = false;
-		}
-	} else {
-		DictChain *save = *lookup->found.foundNext;
-		*lookup->found.foundNext = save->next;
-		lookup->found_any = *lookup->found.foundNext != NULL;
-		dealloc(save, sizeof(DictChain));
-	}
-}
-
-void lookup_next(LookupResult *lookup) {
-	if (lookup->is_first) {
-		lookup->is_first = false;
-		lookup->found.foundNext = &lookup->found.foundFirst->next;
-	} else {
-		lookup->found.foundNext = &(*lookup->found.foundNext)->next;
-	}
-	lookup->found_any = *lookup->found.foundNext;
-}
-
-void *lookup_key(LookupResult *lookup) {
-	if (lookup->is_first) {
-		return lookup->found.foundFirst->key;
-	} else {
-		return (*lookup->found.foundNext)->key;
-	}
-}
-
-void *lookup_val(LookupResult *lookup) {
-	if (lookup->is_first) {
-		return lookup->found.foundFirst->val;
-	} else {
-		return (*lookup->found.foundNext)->val;
-	}
-}
-
 GetResult dict_pop(DictCore *dict, void *key, hash_func_t hash_func, equality_func_t equality_func, dealloc_t dealloc) {
-	LookupResult lookup = dict_lookup(dict, key, hash_func, equality_func);
+	HashResult hash = hash_func(key);
+	LookupResult lookup = hash.success ? dict_find(dict, key, dict_mix(hash.hash), equality_func) : (LookupResult) { .success = false };
 	if (!lookup.success) {
 		return (GetResult) {
 			.val = NULL,
@@ -253,7 +390,7 @@ GetResult dict_pop(DictCore *dict, void *key, hash_func_t hash_func, equality_fu
 			.success = false,
 		};
 	}
-	if (!lookup.found_any) {
+	if (!lookup.found) {
 		return (GetResult) {
 			.val = NULL,
 			.found = false,
@@ -261,55 +398,52 @@ GetResult dict_pop(DictCore *dict, void *key, hash_func_t hash_func, equality_fu
 		};
 	}
 	GetResult result = {
-		.val = lookup.is_first ? lookup.found.foundFirst->val : (*lookup.found.foundNext)->val,
+		.val = lookup.table->entries[lookup.entry].val,
 		.found = true,
 		.success = true,
 	};
-	lookup_pop(&lookup, dealloc);
-
-	dict->len--;
-	dict->generation++;
+	dict_erase(dict, &lookup);
+	if (dict->rehash) {
+		dict_rehash_step(dict, DICT_REHASH_STEP, dealloc);
+	}
 	return result;
 }
 
 bool dict_trace(DictCore *dict, bool (*tracer)(void *key, void **val)) {
 	size_t generation = dict->generation;
-	for (size_t bucket = 0; bucket < dict->cap; bucket++) {
-		for (DictChain *cur = &dict->buckets[bucket]; cur && cur->key; cur = cur->next) {
-			if (generation != dict->generation) {
-				error = exc_msg(&g_RuntimeError, "Dict was modified during iteration");
-				return false;
-			}
-			if (!tracer(cur->key, &cur->val)) {
-				return false;
-			}
+	// the tracer may have moved the table, so nothing about it is kept across calls
+	for (size_t i = 0; i < dict->used; i++) {
+		if (generation != dict->generation) {
+			error = exc_msg(&g_RuntimeError, "Dict was modified during iteration");
+			return false;
+		}
+		DictEntry *entry = &dict_table_of(dict, i)->entries[i];
+		if (entry->key == NULL) {
+			continue;
+		}
+		if (!tracer(entry->key, &entry->val)) {
+			return false;
 		}
 	}
 	return true;
 }
 
 bool dict_popwhere(DictCore *dict, bool (*predicate)(void *key, void *val), dealloc_t dealloc) {
-	for (size_t bucket = 0; bucket < dict->cap; bucket++) {
-		LookupResult iter = {
-			.found.foundFirst = &dict->buckets[bucket],
-			.found_any = dict->buckets[bucket].key != 0,
-			.is_first = true,
-			.success = true,
-		};
-		while (iter.found_any) {
-			size_t generation = dict->generation;
-			bool check = predicate(lookup_key(&iter), lookup_val(&iter));
-			if (dict->generation != generation) {
-				error = exc_msg(&g_RuntimeError, "Dict was modified during iteration");
-				return false;
-			}
-			if (check) {
-				lookup_pop(&iter, dealloc);
-				dict->len--;
-				dict->generation++;
-			} else {
-				lookup_next(&iter);
-			}
+	for (size_t i = 0; i < dict->used; i++) {
+		DictCore *table = dict_table_of(dict, i);
+		DictEntry *entry = &table->entries[i];
+		if (entry->key == NULL) {
+			continue;
+		}
+		size_t generation = dict->generation;
+		bool check = predicate(entry->key, entry->val);
+		if (dict->generation != generation) {
+			error = exc_msg(&g_RuntimeError, "Dict was modified during iteration");
+			return false;
+		}
+		if (check) {
+			LookupResult lookup = dict_lookup(table, NULL, entry->hash, NULL, 0, i);
+			dict_erase(dict, &lookup);
 		}
 	}
 	return true;
@@ -317,12 +451,9 @@ bool dict_popwhere(DictCore *dict, bool (*predicate)(void *key, void *val), deal
 
 size_t dict_size(DictCore *dict) {
 	// we don't need to return any of the stuff which is part of the DictCore struct
-	size_t result = sizeof(DictChain) * dict->cap;
-
-	for (size_t bucket = 0; bucket < dict->cap; bucket++) {
-		for (DictChain *cur = dict->buckets[bucket].next; cur; cur = cur->next) {
-			result += sizeof(DictChain);
-		}
+	size_t result = dict->cap == 0 ? 0 : dict_table_bytes(dict->cap);
+	if (dict->rehash) {
+		result += sizeof(DictRehash) + dict_table_bytes(dict->rehash->old.cap);
 	}
 	return result;
 }
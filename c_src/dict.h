@@ -4,14 +4,22 @@
 #include <stdint.h>
 #include <stddef.h>
 
-typedef struct DictChain {
-	struct DictChain *next;
+typedef struct DictEntry {
+	uint64_t hash; // as mixed by the dict, so resizing never has to ask for it again
 	void *key, *val;
-} DictChain;
+} DictEntry;
+// the entries are kept dense and in insertion order. an open addressing index over cap slots,
+// probed a group of 16 control bytes at a time, says where each one is. cap is a power of two
 typedef struct DictCore {
 	size_t len, cap, generation;
-	DictChain *buckets;
+	size_t used;        // entries taken, counting the ones deleted since the last resize
+	DictEntry *entries; // followed by the control bytes and the index, in the same allocation
+	struct DictRehash *rehash; // while a large dict is growing, a few entries at a time
 } DictCore;
+typedef struct DictRehash {
+	DictCore old; // the table being moved out of. only its entries, index, cap and used mean anything
+	size_t pos;   // entries before this one have been moved
+} DictRehash;
 
 typedef struct EqualityResult {
 	bool equals;
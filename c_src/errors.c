@@ -19,7 +19,7 @@ BUILTIN_TYPE(Cancellation, exception, exc_constructor);
 ExceptionObject MemoryError_inst = {
 	.header = {
 		.type = &g_MemoryError,
-		.table = &exc_table,
+		.table_id = TABLE_EXC,
 	},
 	.args = &empty_tuple,
 };
@@ -64,3 +64,48 @@ Object *exc_nil(TypeObject *type) {
 	}
 	return (Object*)result;
 }
+
+// only one error is pending per thread, so one stand-in will do. it's as good as any other
+// exception to isinstance, and the collector stops at it
+__thread ExceptionObject exc_pending;
+__thread const char *exc_pending_msg;
+__thread Object* exc_pending_arg;
+
+Object *exc_lazy(TypeObject *type, const char *msg, Object *arg) {
+	exc_pending.header.type = type;
+	exc_pending.header.table_id = TABLE_EXC;
+	exc_pending.header.group_id = ROOT_GROUP_ID;
+	exc_pending.header.gc_flags = GC_IMMORTAL | GC_MARKED;
+	exc_pending.args = &empty_tuple;
+	exc_pending_msg = msg;
+	exc_pending_arg = arg;
+	return (Object*)&exc_pending;
+}
+
+Object *exc_lazy_msg(TypeObject *type, const char *msg) {
+	return exc_lazy(type, msg, NULL);
+}
+
+Object *exc_lazy_arg(TypeObject *type, Object *arg) {
+	return exc_lazy(type, NULL, arg);
+}
+
+Object *exc_lazy_nil(TypeObject *type) {
+	return exc_lazy(type, NULL, NULL);
+}
+
+Object *exc_materialize(Object *exc) {
+	if (exc != (Object*)&exc_pending) {
+		return exc;
+	}
+	Object *result;
+	if (exc_pending_msg != NULL) {
+		result = exc_msg(exc_pending.header.type, (char*)exc_pending_msg);
+	} else if (exc_pending_arg != NULL) {
+		result = exc_arg(exc_pending.header.type, exc_pending_arg);
+	} else {
+		result = exc_nil(exc_pending.header.type);
+	}
+	exc_pending_arg = NULL;
+	return result;
+}
@@ -15,9 +15,22 @@ extern TypeObject g_ValueError;
 extern TypeObject g_ZeroDivisionError;
 extern TypeObject g_StopIteration;
 extern TypeObject g_Cancellation;
+extern TypeObject g_OSError;
 
 extern ExceptionObject MemoryError_inst;
 
 Object *exc_msg(TypeObject *type, char *msg);
 Object *exc_arg(TypeObject *type, Object *arg);
 Object *exc_nil(TypeObject *type);
+
+// for errors which C code often catches and throws away. these leave a stand-in owned by the thread
+// in error, and only exc_materialize makes the real exception, once a script could see it. msg has
+// to outlive the error
+Object *exc_lazy_msg(TypeObject *type, const char *msg);
+Object *exc_lazy_arg(TypeObject *type, Object *arg);
+Object *exc_lazy_nil(TypeObject *type);
+// exc if it's real already
+Object *exc_materialize(Object *exc);
+// the stand-in, and its argument, which the collector has to keep alive while it's pending
+extern __thread ExceptionObject exc_pending;
+extern __thread Object* exc_pending_arg;
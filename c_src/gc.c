@@ -1,40 +1,257 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "gc.h"
 #include "dict.h"
 #include "object.h"
 #include "thread.h"
+#include "errors.h"
+#include "weakref.h"
 
-DictCore all_objects;
+// the heap is carved into GC_PAGE_SIZE-aligned pages. small objects live in pages holding equal-sized
+// slots, one list of pages per size class. anything bigger than GC_SMALL_MAX gets a page of its own.
+// aligning pages lets us go from an object to its page by masking the pointer.
+// every threadgroup has its own region of pages, holding the objects and buffers it allocates. when a
+// group dies and nothing in its region survived the mark, the whole region is dropped without sweeping.
+#define GC_PAGE_SIZE (16 * 1024)
+#define GC_SMALL_MAX 1024
+#define GC_NUM_CLASSES 36
+// how many queued finalizers the reclaimer runs each time it has the gil, at least. with a longer
+// queue it runs a fraction of it, so that a big burst of garbage is gone in a few turns and its
+// pages can be given back
+#define GC_FINALIZE_BATCH 64
+#define GC_FINALIZE_FRACTION 8
+// the pacer never waits for less than this much allocation between collections
+#define GC_MIN_GOAL (4 * 1024 * 1024)
+
+// pages are carved out of arenas mapped straight from the os instead of coming from malloc, so
+// that what a collection frees can be handed back. freeing a page only marks its chunks dirty.
+// once a cycle's sweep is done the empty pages are released, the dirty chunks are given back with
+// MADV_DONTNEED and arenas with nothing left in them are unmapped. until then the dirty chunks can
+// be reused without faulting them in again. large pages which would take up too much of an arena
+// get a mapping of their own, which goes as soon as they die.
+#define GC_ARENA_SIZE (2 * 1024 * 1024)
+#define GC_ARENA_CHUNKS (GC_ARENA_SIZE / GC_PAGE_SIZE)
+#define GC_ARENA_MAX_RUN (GC_ARENA_CHUNKS / 4)
+// with OLY_HUGEPAGES set, arenas ask for transparent huge pages once the heap is this big
+#define GC_HUGEPAGE_MIN (64 * 1024 * 1024)
+
+typedef enum SlotState {
+	SLOT_FREE = 0,
+	SLOT_LIVE,       // the mark bit is in the object header
+	SLOT_FINALIZING, // dead, waiting in the finalizer queue or for the end of the sweep cycle
+	SLOT_RAW,        // a quota buffer. never swept, only freed by quota_dealloc
+} SlotState;
+
+typedef struct GcPage {
+	struct GcPage *next, *prev;
+	struct GcHeap *heap;
+	struct GcArena *arena; // NULL if the page has a mapping of its own
+	size_t slot_size;
+	size_t slot_count;
+	uint64_t slot_recip; // 2^32 / slot_size, rounded up, so slot_index can multiply instead of divide
+	size_t sweep_epoch; // the page has been swept since the last mark iff this equals gc_epoch
+	void *free_list;    // threaded through the first word of each free slot
+	size_t free_count;
+	char *slots;
+	uint8_t state[];
+} GcPage;
+
+typedef struct GcArena {
+	char *base;
+	size_t index; // in arenas
+	size_t free_count;
+	uint64_t used[GC_ARENA_CHUNKS / 64];
+	uint64_t dirty[GC_ARENA_CHUNKS / 64]; // free, but maybe still backed by memory
+} GcArena;
+
+typedef struct GcSizeClass {
+	GcPage *pages;        // every page of this class
+	GcPage *sweep_cursor; // next page which may need sweeping or may have free slots
+	GcPage *current;      // page we are allocating out of
+} GcSizeClass;
+
+typedef struct GcHeap {
+	struct GcHeap *next, *prev;
+	ThreadGroupObject *owner;
+	GcSizeClass size_classes[GC_NUM_CLASSES];
+	GcPage *large_pages;
+	GcPage *large_cursor;
+	bool donated;    // something left the owner, so things here may be in use by another group
+	bool orphaned;   // the owner died in the last mark
+	bool doomed;     // ...and nothing here is needed by anyone else. with nothing donated, anything
+	                 // live in here would belong to the owner and so would have kept it alive
+} GcHeap;
+
+typedef struct ObjectQueue {
+	Object **data;
+	size_t len, cap;
+} ObjectQueue;
+
+// each GC_PAGE_SIZE chunk of every page -> its GcPage*, as a two level table on the chunk number.
+// user space addresses are 48 bits, so that's 34 bits of chunk number
+#define GC_MAP_BITS 17
+GcPage **page_map[1 << GC_MAP_BITS];
+size_t page_count = 0;
+uintptr_t heap_lo = UINTPTR_MAX, heap_hi = 0; // bounds on the addresses any page has ever had
 DictCore roots;
 
-void *quota_alloc(size_t size, ThreadGroupObject *group) {
-	if (group->mem_used + size > group->mem_limit) {
+GcArena **arenas; // with holes where arenas were unmapped
+size_t arenas_len = 0, arenas_cap = 0;
+size_t arena_cursor = 0; // no arena before this one has a free chunk
+size_t dirty_chunks = 0;
+bool arena_hugepages = false;
+bool purge_pending = false; // the last mark's sweep hasn't been followed by a purge yet
+
+ThreadGroupObject *root_group_slot[] = { &root_threadgroup };
+ThreadGroupObject **thread_groups = root_group_slot;
+size_t thread_groups_cap = 1;
+uint32_t *free_group_ids;
+size_t free_group_ids_len = 0, free_group_ids_cap = 0;
+uint32_t next_group_id = 1;
+
+GcHeap *gc_heaps = NULL;
+
+extern Object *__start_static_objects;
+extern Object *__stop_static_objects;
+// the static objects whose contents can change, and so can point into the heap
+Object **static_roots;
+size_t static_roots_len = 0;
+size_t gc_epoch = 0;
+size_t sweep_pending = 0; // pages which have not been swept since the last mark
+
+ObjectQueue finalize_queue;
+ObjectQueue reclaim_pages; // released pages for the reclaimer to unmap without the gil
+bool reclaimer_started = false;
+pthread_cond_t reclaim_cond = PTHREAD_COND_INITIALIZER;
+void gc_wake_reclaimer();
+ObjectQueue dead_groups;
+ObjectQueue weak_queue; // live weakrefs and weakdicts found by the current mark
+ObjectQueue remembered; // objects which may hold references into other groups' regions
+bool remembered_lost = false; // one couldn't be queued. only full collections are safe until the next one
+
+GcStats gc_stats = {
+	.gogc = 100,
+	.next_gc = GC_MIN_GOAL,
+};
+GcTrigger gc_pending = GC_TRIGGER_NONE;
+uint32_t gc_pending_group; // which group a GC_TRIGGER_GROUP is for
+volatile sig_atomic_t gc_dump_requested = 0;
+
+void gc_dump_signal(int sig) {
+	gc_dump_requested = 1;
+}
+
+void gc_request(GcTrigger trigger) {
+	if (gc_pending == GC_TRIGGER_NONE) {
+		gc_pending = trigger;
+	}
+}
+
+// account for an allocation and ask for a collection at the next probe if it's time
+void gc_pace(size_t size, ThreadGroupObject *group) {
+	gc_stats.bytes_allocated += size;
+	gc_stats.bytes_since_gc += size;
+	if (group->gc_cycle != gc_stats.collections) {
+		// nothing of the group's was found live
+		group->gc_cycle = gc_stats.collections;
+		group->gc_live = 0;
+		group->gc_allocated = 0;
+	}
+	group->gc_allocated += size;
+	if (gc_stats.gogc == 0) {
+		return;
+	}
+	if (gc_stats.bytes_since_gc >= gc_stats.next_gc) {
+		gc_request(GC_TRIGGER_HEAP);
+	}
+
+	// each group also gets its own goal, so a small group doesn't fill up with garbage
+	// waiting on the rest of the heap. it has the same floor as the heap's, and is capped at half
+	// of what the group has left, which is what keeps small groups collecting. like the heap's, it
+	// counts allocation rather than mem_used, which still holds the garbage the sweep hasn't reached.
+	uint64_t live = group->gc_live;
+	uint64_t goal = live / 100 * gc_stats.gogc;
+	if (goal < GC_MIN_GOAL) {
+		goal = GC_MIN_GOAL;
+	}
+	// making a child group can leave mem_limit below what the last mark found live
+	uint64_t headroom = live >= group->mem_limit ? 0 : (group->mem_limit - live) / 2;
+	if (goal > headroom) {
+		goal = headroom;
+	}
+	if (group->gc_allocated > goal && gc_pending == GC_TRIGGER_NONE) {
+		gc_request(GC_TRIGGER_GROUP);
+		gc_pending_group = group->id;
+	}
+}
+
+void *region_alloc(ThreadGroupObject *group, size_t size, uint8_t state, size_t clear);
+void region_free(void *ptr);
+size_t region_capacity(void *ptr);
+
+void *quota_alloc_inner(size_t size, ThreadGroupObject *group, size_t clear) {
+	if (group->mem_used + size > group->mem_limit && !gc_reclaim(group, size)) {
 		return NULL;
 	}
-	void *result = calloc(size, 1);
+	void *result = region_alloc(group, size, SLOT_RAW, clear);
 	if (result == NULL) {
 		return NULL;
 	}
 	group->mem_used += size;
+	gc_pace(size, group);
 	return result;
 }
 
+void *quota_alloc(size_t size, ThreadGroupObject *group) {
+	return quota_alloc_inner(size, group, size);
+}
+
+void *quota_alloc_uninit(size_t size, ThreadGroupObject *group) {
+	return quota_alloc_inner(size, group, 0);
+}
+
+bool gc_finalizing = false;
+
 void quota_dealloc(void *ptr, size_t size, ThreadGroupObject *group) {
-	group->mem_used -= size;
-	free(ptr);
+	// a dead object's buffers were charged back when it was swept, and its group may be gone already
+	if (!gc_finalizing) {
+		group->mem_used -= size;
+		gc_stats.bytes_freed += size;
+	}
+	region_free(ptr);
 }
 
 void *quota_realloc(void *ptr, size_t newsize, size_t oldsize, ThreadGroupObject *group) {
-	if (group->mem_used - oldsize + newsize > group->mem_limit) {
+	if (group->mem_used - oldsize + newsize > group->mem_limit && !gc_reclaim(group, newsize - oldsize)) {
 		return NULL;
 	}
-	void *result = realloc(ptr, newsize);
-	if (result == NULL) {
-		return NULL;
+	void *result = ptr;
+	if (newsize > region_capacity(ptr)) {
+		size_t kept = ptr == NULL ? 0 : oldsize < newsize ? oldsize : newsize;
+		result = region_alloc(group, newsize, SLOT_RAW, 0);
+		if (result == NULL) {
+			return NULL;
+		}
+		memset((char*)result + kept, 0, newsize - kept);
+		if (ptr != NULL) {
+			memcpy(result, ptr, kept);
+			region_free(ptr);
+		}
 	}
 	group->mem_used += newsize - oldsize;
+	if (newsize > oldsize) {
+		gc_pace(newsize - oldsize, group);
+	} else {
+		gc_stats.bytes_freed += oldsize - newsize;
+	}
 	return result;
 }
 
@@ -45,6 +262,13 @@ void *current_thread_alloc(size_t size) {
 	return quota_alloc(size, CURRENT_GROUP);
 }
 
+void *current_thread_alloc_uninit(size_t size) {
+	if (oly_thread == NULL) {
+		return global_alloc(size);
+	}
+	return quota_alloc_uninit(size, CURRENT_GROUP);
+}
+
 void current_thread_dealloc(void *ptr, size_t size) {
 	if (oly_thread == NULL) {
 		abort();
@@ -81,122 +305,1466 @@ EqualityResult gc_equals(void *val1, void *val2) {
 	};
 }
 
-bool gc_add(Object *obj) {
-	return dict_set(&all_objects, obj, NULL, gc_hasher, gc_equals, global_alloc, global_dealloc);
+bool queue_push(ObjectQueue *queue, Object *obj) {
+	if (queue->len == queue->cap) {
+		size_t new_cap = queue->cap * 2 + 16;
+		Object **new_data = realloc(queue->data, sizeof(Object*) * new_cap);
+		if (new_data == NULL) {
+			return false;
+		}
+		queue->data = new_data;
+		queue->cap = new_cap;
+	}
+	queue->data[queue->len++] = obj;
+	return true;
 }
 
-extern Object *__start_static_objects;
-extern Object *__stop_static_objects;
+/////////////////////////////////////
+/// arenas
+/////////////////////////////////////
+
+bool chunk_bit(uint64_t *bits, size_t i) {
+	return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+void chunk_bits_set(uint64_t *bits, size_t start, size_t count, bool value) {
+	for (size_t i = start; i < start + count; i++) {
+		if (value) {
+			bits[i / 64] |= (uint64_t)1 << (i % 64);
+		} else {
+			bits[i / 64] &= ~((uint64_t)1 << (i % 64));
+		}
+	}
+}
+
+// mmap only promises os page alignment, so map extra and trim it off
+void *map_aligned(size_t bytes, size_t align) {
+	char *raw = mmap(NULL, bytes + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		return NULL;
+	}
+	char *start = (char*)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+	if (start != raw) {
+		munmap(raw, start - raw);
+	}
+	munmap(start + bytes, raw + align - start);
+	if (arena_hugepages && gc_stats.mapped_bytes >= GC_HUGEPAGE_MIN) {
+		madvise(start, bytes, MADV_HUGEPAGE);
+	}
+	gc_stats.mapped_bytes += bytes;
+	return start;
+}
+
+GcArena *arena_new() {
+	size_t index = 0;
+	while (index < arenas_len && arenas[index] != NULL) {
+		index++;
+	}
+	if (index == arenas_cap) {
+		size_t new_cap = arenas_cap * 2 + 16;
+		GcArena **new_arenas = realloc(arenas, sizeof(GcArena*) * new_cap);
+		if (new_arenas == NULL) {
+			return NULL;
+		}
+		arenas = new_arenas;
+		arenas_cap = new_cap;
+	}
+	GcArena *arena = global_alloc(sizeof(GcArena));
+	if (arena == NULL) {
+		return NULL;
+	}
+	arena->base = map_aligned(GC_ARENA_SIZE, GC_ARENA_SIZE);
+	if (arena->base == NULL) {
+		global_dealloc(arena, sizeof(GcArena));
+		return NULL;
+	}
+	arena->index = index;
+	arena->free_count = GC_ARENA_CHUNKS;
+	memset(arena->used, 0, sizeof(arena->used));
+	memset(arena->dirty, 0, sizeof(arena->dirty));
+	arenas[index] = arena;
+	if (index == arenas_len) {
+		arenas_len++;
+	}
+	if (index < arena_cursor) {
+		arena_cursor = index;
+	}
+	return arena;
+}
+
+// the first run of count free chunks in the lowest arena which has one, to keep the heap packed
+void *chunks_alloc(size_t count, GcArena **arena_out) {
+	while (arena_cursor < arenas_len && (arenas[arena_cursor] == NULL || arenas[arena_cursor]->free_count == 0)) {
+		arena_cursor++;
+	}
+	for (size_t a = arena_cursor; ; a++) {
+		GcArena *arena = a < arenas_len ? arenas[a] : arena_new();
+		if (arena == NULL) {
+			if (a >= arenas_len) {
+				return NULL;
+			}
+			continue;
+		}
+		if (arena->free_count < count) {
+			continue;
+		}
+		size_t run = 0;
+		for (size_t i = 0; i < GC_ARENA_CHUNKS; i++) {
+			run = chunk_bit(arena->used, i) ? 0 : run + 1;
+			if (run == count) {
+				size_t start = i + 1 - count;
+				for (size_t j = start; j <= i; j++) {
+					dirty_chunks -= chunk_bit(arena->dirty, j);
+				}
+				chunk_bits_set(arena->used, start, count, true);
+				chunk_bits_set(arena->dirty, start, count, false);
+				arena->free_count -= count;
+				*arena_out = arena;
+				return arena->base + start * GC_PAGE_SIZE;
+			}
+		}
+	}
+}
+
+void chunks_free(GcArena *arena, void *ptr, size_t count) {
+	size_t start = ((char*)ptr - arena->base) / GC_PAGE_SIZE;
+	chunk_bits_set(arena->used, start, count, false);
+	chunk_bits_set(arena->dirty, start, count, true);
+	arena->free_count += count;
+	dirty_chunks += count;
+	if (arena->index < arena_cursor) {
+		arena_cursor = arena->index;
+	}
+}
+
+// give the memory of free chunks back to the os until only `keep` of them are left, starting from the
+// top so that what stays is packed low
+void arena_purge(size_t keep) {
+	for (size_t a = arenas_len; a > 0 && dirty_chunks > keep; a--) {
+		GcArena *arena = arenas[a - 1];
+		if (arena == NULL) {
+			continue;
+		}
+		if (arena->free_count == GC_ARENA_CHUNKS) {
+			size_t dirty = 0;
+			for (size_t w = 0; w < GC_ARENA_CHUNKS / 64; w++) {
+				dirty += __builtin_popcountll(arena->dirty[w]);
+			}
+			munmap(arena->base, GC_ARENA_SIZE);
+			gc_stats.mapped_bytes -= GC_ARENA_SIZE;
+			gc_stats.bytes_returned += dirty * GC_PAGE_SIZE;
+			dirty_chunks -= dirty;
+			arenas[a - 1] = NULL;
+			global_dealloc(arena, sizeof(GcArena));
+			continue;
+		}
+		for (size_t i = GC_ARENA_CHUNKS; i > 0 && dirty_chunks > keep; ) {
+			if (!chunk_bit(arena->dirty, i - 1)) {
+				i--;
+				continue;
+			}
+			size_t end = i;
+			while (i > 0 && chunk_bit(arena->dirty, i - 1) && dirty_chunks > keep) {
+				i--;
+				dirty_chunks--;
+			}
+			madvise(arena->base + i * GC_PAGE_SIZE, (end - i) * GC_PAGE_SIZE, MADV_DONTNEED);
+			chunk_bits_set(arena->dirty, i, end - i, false);
+			gc_stats.bytes_returned += (end - i) * GC_PAGE_SIZE;
+		}
+	}
+	while (arenas_len > 0 && arenas[arenas_len - 1] == NULL) {
+		arenas_len--;
+	}
+}
+
+/////////////////////////////////////
+/// pages
+/////////////////////////////////////
+
+// 8 byte steps up to 128, 16 byte steps up to 256, then 64 byte steps up to GC_SMALL_MAX.
+// most objects are a header and a couple of words, so the small steps are where the memory is
+size_t size_class_index(size_t size) {
+	if (size <= 128) {
+		return size == 0 ? 0 : (size - 1) / 8;
+	}
+	if (size <= 256) {
+		return 16 + (size - 128 - 1) / 16;
+	}
+	return 24 + (size - 256 - 1) / 64;
+}
+
+size_t size_class_slot(size_t index) {
+	if (index < 16) {
+		return (index + 1) * 8;
+	}
+	if (index < 24) {
+		return 128 + (index - 16 + 1) * 16;
+	}
+	return 256 + (index - 24 + 1) * 64;
+}
+
+GcPage *page_of(Object *obj) {
+	if ((uintptr_t)obj < heap_lo || (uintptr_t)obj >= heap_hi) {
+		return NULL;
+	}
+	uintptr_t chunk = (uintptr_t)obj / GC_PAGE_SIZE;
+	GcPage **leaf = page_map[chunk >> GC_MAP_BITS];
+	return leaf == NULL ? NULL : leaf[chunk & ((1 << GC_MAP_BITS) - 1)];
+}
+
+bool page_map_set(void *chunk_addr, GcPage *page) {
+	uintptr_t chunk = (uintptr_t)chunk_addr / GC_PAGE_SIZE;
+	if (chunk >> (2 * GC_MAP_BITS)) {
+		return false;
+	}
+	GcPage ***leaf = &page_map[chunk >> GC_MAP_BITS];
+	if (*leaf == NULL) {
+		*leaf = global_alloc(sizeof(GcPage*) << GC_MAP_BITS);
+		if (*leaf == NULL) {
+			return false;
+		}
+	}
+	(*leaf)[chunk & ((1 << GC_MAP_BITS) - 1)] = page;
+	return true;
+}
+
+// the slot obj points into, or slot_count if it's past the end of the page
+size_t slot_index(GcPage *page, Object *obj) {
+	size_t offset = (char*)obj - page->slots;
+	if (page->slot_count == 1) {
+		return offset < page->slot_size ? 0 : 1;
+	}
+	// exact, since offset is under GC_PAGE_SIZE
+	return (offset * page->slot_recip) >> 32;
+}
+
+size_t page_bytes(GcPage *page) {
+	size_t bytes = (size_t)(page->slots - (char*)page) + page->slot_size * page->slot_count;
+	return (bytes + GC_PAGE_SIZE - 1) & ~(size_t)(GC_PAGE_SIZE - 1);
+}
+
+// the memory of a page with a mapping of its own. doesn't need the gil
+void page_unmap(GcPage *page) {
+	munmap(page, page_bytes(page));
+}
+
+GcPage *page_new(size_t slot_size, size_t slot_count, size_t bytes) {
+	GcArena *arena = NULL;
+	GcPage *page = bytes / GC_PAGE_SIZE <= GC_ARENA_MAX_RUN ? chunks_alloc(bytes / GC_PAGE_SIZE, &arena) : map_aligned(bytes, GC_PAGE_SIZE);
+	if (page == NULL) {
+		return NULL;
+	}
+	// register every chunk so that pointers into the middle of large objects can be found
+	for (size_t offset = 0; offset < bytes; offset += GC_PAGE_SIZE) {
+		if (!page_map_set((char*)page + offset, page)) {
+			for (size_t undo = 0; undo < offset; undo += GC_PAGE_SIZE) {
+				page_map_set((char*)page + undo, NULL);
+			}
+			if (arena != NULL) {
+				chunks_free(arena, page, bytes / GC_PAGE_SIZE);
+			} else {
+				munmap(page, bytes);
+				gc_stats.mapped_bytes -= bytes;
+			}
+			return NULL;
+		}
+	}
+	page_count++;
+	if ((uintptr_t)page < heap_lo) {
+		heap_lo = (uintptr_t)page;
+	}
+	if ((uintptr_t)page + bytes > heap_hi) {
+		heap_hi = (uintptr_t)page + bytes;
+	}
+	page->next = NULL;
+	page->prev = NULL;
+	page->arena = arena;
+	page->slot_size = slot_size;
+	page->slot_count = slot_count;
+	page->slot_recip = (UINT32_MAX / slot_size) + 1;
+	page->sweep_epoch = gc_epoch;
+	page->free_list = NULL;
+	page->free_count = 0;
+	page->slots = (char*)page + ((sizeof(GcPage) + slot_count + 15) & ~(size_t)15);
+	memset(page->state, SLOT_FREE, slot_count);
+	return page;
+}
+
+void page_release(GcPage *page) {
+	size_t bytes = page_bytes(page);
+	for (size_t offset = 0; offset < bytes; offset += GC_PAGE_SIZE) {
+		page_map_set((char*)page + offset, NULL);
+	}
+	page_count--;
+	if (page->arena != NULL) {
+		chunks_free(page->arena, page, bytes / GC_PAGE_SIZE);
+		return;
+	}
+	gc_stats.mapped_bytes -= bytes;
+	gc_stats.bytes_returned += bytes;
+	if (reclaimer_started && queue_push(&reclaim_pages, (Object*)page)) {
+		pthread_cond_signal(&reclaim_cond);
+	} else {
+		page_unmap(page);
+	}
+}
+
+GcHeap *heap_of(ThreadGroupObject *group) {
+	if (group->heap != NULL) {
+		return group->heap;
+	}
+	GcHeap *heap = global_alloc(sizeof(GcHeap));
+	if (heap == NULL) {
+		return NULL;
+	}
+	heap->owner = group;
+	heap->next = gc_heaps;
+	if (gc_heaps) {
+		gc_heaps->prev = heap;
+	}
+	gc_heaps = heap;
+	group->heap = heap;
+	return heap;
+}
+
+GcPage *small_page_new(GcHeap *heap, size_t index) {
+	size_t slot_size = size_class_slot(index);
+	// solve header + slot_count + slot_count * slot_size <= GC_PAGE_SIZE, leaving room to align the slots
+	size_t slot_count = (GC_PAGE_SIZE - sizeof(GcPage) - 15) / (slot_size + 1);
+	GcPage *page = page_new(slot_size, slot_count, GC_PAGE_SIZE);
+	if (page == NULL) {
+		return NULL;
+	}
+	for (size_t i = slot_count; i > 0; i--) {
+		void **slot = (void**)(page->slots + (i - 1) * slot_size);
+		*slot = page->free_list;
+		page->free_list = slot;
+	}
+	page->free_count = slot_count;
+	page->heap = heap;
+
+	GcSizeClass *class = &heap->size_classes[index];
+	page->next = class->pages;
+	if (class->pages) {
+		class->pages->prev = page;
+	}
+	class->pages = page;
+	return page;
+}
+
+void slot_free(GcPage *page, size_t idx) {
+	page->state[idx] = SLOT_FREE;
+	if (page->slot_count == 1) {
+		// large page. take it out of the list
+		GcHeap *heap = page->heap;
+		if (page == heap->large_cursor) {
+			heap->large_cursor = page->next;
+		}
+		if (page->prev) {
+			page->prev->next = page->next;
+		} else {
+			heap->large_pages = page->next;
+		}
+		if (page->next) {
+			page->next->prev = page->prev;
+		}
+		page_release(page);
+		return;
+	}
+	void **slot = (void**)(page->slots + idx * page->slot_size);
+	*slot = page->free_list;
+	page->free_list = slot;
+	page->free_count++;
+}
+
+// the object is dead and finalized. give its memory back.
+void object_release(GcPage *page, size_t idx) {
+	Object *obj = (Object*)(page->slots + idx * page->slot_size);
+	size_t obj_size = size(obj);
+	GROUP(obj)->mem_used -= obj_size;
+	gc_stats.bytes_freed += obj_size;
+	slot_free(page, idx);
+}
+
+/////////////////////////////////////
+/// sweeping
+/////////////////////////////////////
+
+extern ObjectTable threadgroup_table;
+
+// free what the mark didn't reach and unmark the rest
+void sweep_slots(GcPage *page) {
+	// walk backwards so the free list comes out in address order
+	for (size_t i = page->slot_count; i > 0; i--) {
+		size_t idx = i - 1;
+		if (page->state[idx] != SLOT_LIVE) {
+			continue;
+		}
+		Object *obj = (Object*)(page->slots + idx * page->slot_size);
+		if (obj->gc_flags & GC_MARKED) {
+			obj->gc_flags &= ~GC_MARKED;
+			continue;
+		}
+		gc_stats.objects_freed++;
+		if (obj->table_id == TABLE_THREADGROUP) {
+			// everything in a dead group is dead too, but its members may not have been swept yet and
+			// they need the group to settle their accounts. give the quota back now, free it later.
+			TABLE(obj)->finalize(obj);
+			page->state[idx] = SLOT_FINALIZING;
+			if (!queue_push(&dead_groups, obj)) {
+				puts("Fatal error: could not queue dead threadgroup");
+				abort();
+			}
+		} else if (TABLE(obj)->finalize != null_finalize) {
+			// the quota comes back now. the buffers are given back by the reclaimer
+			size_t obj_size = size(obj);
+			GROUP(obj)->mem_used -= obj_size;
+			gc_stats.bytes_freed += obj_size;
+			page->state[idx] = SLOT_FINALIZING;
+			if (!queue_push(&finalize_queue, obj)) {
+				puts("Fatal error: could not queue finalizer");
+				abort();
+			}
+			gc_wake_reclaimer();
+		} else {
+			// this might free the page, but only large pages, which only have this one slot
+			object_release(page, idx);
+		}
+	}
+}
+
+void sweep_page(GcPage *page) {
+	if (page->sweep_epoch == gc_epoch) {
+		return;
+	}
+	page->sweep_epoch = gc_epoch;
+	sweep_pending--;
+	sweep_slots(page);
+}
+
+void *small_alloc(GcHeap *heap, size_t size, uint8_t state, size_t clear) {
+	GcSizeClass *class = &heap->size_classes[size_class_index(size)];
+	while (class->current == NULL || class->current->free_count == 0) {
+		GcPage *page = class->sweep_cursor;
+		if (page == NULL) {
+			page = small_page_new(heap, size_class_index(size));
+			if (page == NULL) {
+				return NULL;
+			}
+		} else {
+			class->sweep_cursor = page->next;
+			sweep_page(page);
+		}
+		class->current = page;
+	}
+
+	GcPage *page = class->current;
+	void **slot = page->free_list;
+	page->free_list = *slot;
+	page->free_count--;
+	page->state[slot_index(page, (Object*)slot)] = state;
+	memset(slot, 0, clear);
+	return slot;
+}
+
+void *large_alloc(GcHeap *heap, size_t size, uint8_t state, size_t clear) {
+	// pay for this allocation by sweeping a couple of the other large objects
+	for (int i = 0; i < 2 && heap->large_cursor; i++) {
+		GcPage *page = heap->large_cursor;
+		heap->large_cursor = page->next;
+		sweep_page(page);
+	}
+
+	size_t header = (sizeof(GcPage) + 1 + 15) & ~(size_t)15;
+	size_t bytes = (header + size + GC_PAGE_SIZE - 1) & ~(size_t)(GC_PAGE_SIZE - 1);
+	GcPage *page = page_new(size, 1, bytes);
+	if (page == NULL) {
+		return NULL;
+	}
+	page->heap = heap;
+	page->next = heap->large_pages;
+	if (heap->large_pages) {
+		heap->large_pages->prev = page;
+	}
+	heap->large_pages = page;
+	page->state[0] = state;
+	memset(page->slots, 0, clear);
+	return page->slots;
+}
+
+// only the first `clear` bytes are zeroed
+void *region_alloc(ThreadGroupObject *group, size_t size, uint8_t state, size_t clear) {
+	GcHeap *heap = heap_of(group);
+	if (heap == NULL) {
+		return NULL;
+	}
+	return size <= GC_SMALL_MAX ? small_alloc(heap, size, state, clear) : large_alloc(heap, size, state, clear);
+}
+
+void region_free(void *ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	GcPage *page = page_of(ptr);
+	if (page == NULL) {
+		// static objects fill their buffers before there is anyone to charge for them
+		free(ptr);
+		return;
+	}
+	slot_free(page, slot_index(page, ptr));
+}
+
+// how much can be stored at ptr without moving it
+size_t region_capacity(void *ptr) {
+	GcPage *page = ptr == NULL ? NULL : page_of(ptr);
+	return page == NULL ? 0 : page->slot_size;
+}
+
+// run up to `budget` queued finalizers and release their objects. they were paid for at the sweep
+void gc_run_finalizers(size_t budget) {
+	gc_finalizing = true;
+	while (finalize_queue.len && budget--) {
+		Object *obj = finalize_queue.data[--finalize_queue.len];
+		TABLE(obj)->finalize(obj);
+		GcPage *page = page_of(obj);
+		slot_free(page, slot_index(page, obj));
+	}
+	gc_finalizing = false;
+}
+
+// finalizing is left to a thread of its own, so a collection doesn't have to wait on freeing
+// everything that died. it still needs the gil to touch the heap, but it takes it in batches, the
+// same way script threads take turns. large pages with mappings of their own are unmapped with the
+// gil released.
+void *gc_reclaimer(void *arg) {
+	gil_acquire();
+	while (true) {
+		while (finalize_queue.len == 0 && reclaim_pages.len == 0) {
+			pthread_cond_wait(&reclaim_cond, &gil);
+		}
+		size_t batch = finalize_queue.len / GC_FINALIZE_FRACTION;
+		gc_run_finalizers(batch > GC_FINALIZE_BATCH ? batch : GC_FINALIZE_BATCH);
+
+		ObjectQueue pages = reclaim_pages;
+		reclaim_pages = (ObjectQueue) {0};
+		void sleeper() {
+			for (size_t i = 0; i < pages.len; i++) {
+				page_unmap((GcPage*)pages.data[i]);
+			}
+			free(pages.data);
+			// let the script threads in before going again
+			struct timespec timespec = { 0, 100 };
+			nanosleep(&timespec, NULL);
+		}
+		gil_yield(sleeper);
+	}
+	return NULL;
+}
+
+void gc_wake_reclaimer() {
+	if (!reclaimer_started) {
+		pthread_t tid;
+		if (pthread_create(&tid, NULL, gc_reclaimer, NULL) != 0) {
+			// gc_probe will have to do it
+			return;
+		}
+		pthread_detach(tid);
+		reclaimer_started = true;
+	}
+	pthread_cond_signal(&reclaim_cond);
+}
+
+void heap_sweep(GcHeap *heap) {
+	for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+		for (GcPage *page = heap->size_classes[i].sweep_cursor; page; page = page->next) {
+			sweep_page(page);
+		}
+		// start over from the top so the pages with space get used again
+		heap->size_classes[i].sweep_cursor = heap->size_classes[i].pages;
+	}
+	while (heap->large_cursor) {
+		GcPage *page = heap->large_cursor;
+		heap->large_cursor = page->next;
+		sweep_page(page);
+	}
+}
+
+// release the small pages which the sweep left with nothing in them, past the first `keep`
+void heap_trim(GcHeap *heap, size_t *keep) {
+	for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+		GcSizeClass *class = &heap->size_classes[i];
+		for (GcPage *page = class->pages, *next; page; page = next) {
+			next = page->next;
+			if (page->free_count != page->slot_count) {
+				continue;
+			}
+			if (*keep > 0) {
+				(*keep)--;
+				continue;
+			}
+			if (page->prev) {
+				page->prev->next = page->next;
+			} else {
+				class->pages = page->next;
+			}
+			if (page->next) {
+				page->next->prev = page->prev;
+			}
+			if (class->current == page) {
+				class->current = NULL;
+			}
+			page_release(page);
+		}
+		class->sweep_cursor = class->pages;
+	}
+}
+
+void heap_unlink(GcHeap *heap) {
+	if (heap->prev) {
+		heap->prev->next = heap->next;
+	} else {
+		gc_heaps = heap->next;
+	}
+	if (heap->next) {
+		heap->next->prev = heap->prev;
+	}
+}
+
+// hand the pages of a dead group's region over to the root group
+void heap_adopt(GcHeap *heap) {
+	GcHeap *parent = heap_of(&root_threadgroup);
+	if (parent == NULL) {
+		puts("Fatal error: could not adopt region");
+		abort();
+	}
+	void adopt_list(GcPage **from, GcPage **to) {
+		GcPage *last = NULL;
+		for (GcPage *page = *from; page; page = page->next) {
+			page->heap = parent;
+			last = page;
+		}
+		if (last) {
+			last->next = *to;
+			if (*to) {
+				(*to)->prev = last;
+			}
+			*to = *from;
+		}
+	}
+	for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+		adopt_list(&heap->size_classes[i].pages, &parent->size_classes[i].pages);
+		parent->size_classes[i].sweep_cursor = parent->size_classes[i].pages;
+	}
+	adopt_list(&heap->large_pages, &parent->large_pages);
+	heap_unlink(heap);
+	global_dealloc(heap, sizeof(GcHeap));
+}
+
+// everything in the region is dead and belongs to its dead owner, who has no account to settle
+// anymore. none of it needs finalizing either: the finalizers only give back buffers, which are in
+// the region too, or quota to groups which are themselves in the region.
+void heap_release(GcHeap *heap) {
+	void release_list(GcPage *page) {
+		while (page) {
+			GcPage *next = page->next;
+			if (page->sweep_epoch != gc_epoch) {
+				sweep_pending--;
+			}
+			page_release(page);
+			page = next;
+		}
+	}
+	for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+		release_list(heap->size_classes[i].pages);
+	}
+	release_list(heap->large_pages);
+	heap_unlink(heap);
+	global_dealloc(heap, sizeof(GcHeap));
+	gc_stats.regions_released++;
+}
+
+bool gc_finish_sweep() {
+	bool did_work = sweep_pending != 0 || dead_groups.len != 0;
+
+	bool any_doomed = false;
+	for (GcHeap *heap = gc_heaps; heap; heap = heap->next) {
+		if (!heap->doomed) {
+			heap_sweep(heap);
+		}
+		any_doomed |= heap->doomed;
+	}
+	if (any_doomed) {
+		// objects from an earlier cycle may still be waiting on the reclaimer in a region which is
+		// about to be dropped. their buffers go with it, so just forget them
+		size_t kept = 0;
+		for (size_t i = 0; i < finalize_queue.len; i++) {
+			if (!page_of(finalize_queue.data[i])->heap->doomed) {
+				finalize_queue.data[kept++] = finalize_queue.data[i];
+			}
+		}
+		finalize_queue.len = kept;
+	}
+
+	// the finalizers don't touch the groups, so all of this can happen with them still queued.
+	// settle the groups' own accounts first, since a dead group may be the owner of another one
+	for (size_t i = 0; i < dead_groups.len; i++) {
+		Object *obj = dead_groups.data[i];
+		size_t obj_size = size(obj);
+		GROUP(obj)->mem_used -= obj_size;
+		gc_stats.bytes_freed += obj_size;
+	}
+	for (GcHeap *heap = gc_heaps, *next; heap; heap = next) {
+		next = heap->next;
+		if (heap->orphaned) {
+			gc_unregister_group(heap->owner);
+			if (!heap->doomed) {
+				heap_adopt(heap);
+			}
+		}
+	}
+	for (size_t i = 0; i < dead_groups.len; i++) {
+		Object *obj = dead_groups.data[i];
+		GcPage *page = page_of(obj);
+		slot_free(page, slot_index(page, obj));
+	}
+	dead_groups.len = 0;
+	for (GcHeap *heap = gc_heaps, *next; heap; heap = next) {
+		next = heap->next;
+		if (heap->doomed) {
+			heap_release(heap);
+		}
+	}
+
+	// the cycle is over, so hand back what it freed. what the pacer will let the program allocate
+	// before the next collection is kept, since it would only be faulted back in
+	if (purge_pending) {
+		size_t keep = gc_stats.next_gc / GC_PAGE_SIZE;
+		for (GcHeap *heap = gc_heaps; heap; heap = heap->next) {
+			heap_trim(heap, &keep);
+		}
+		arena_purge(keep);
+		purge_pending = false;
+	}
+	return did_work;
+}
+
+bool gc_can_collect_group(ThreadGroupObject *group);
+bool gc_collecting = false;
+
+// the slow path for an allocation that doesn't fit in its group's quota. mem_used still counts
+// everything since the last mark, so first finish the sweep, starting with the group's own region,
+// and if that isn't enough, collect right here: the group's region by itself, then everything.
+// this is only safe because the stacks are scanned: whatever the caller is holding in its frame
+// stays alive. with precise roots, half-built objects would be lost, so wait for the next probe.
+bool gc_reclaim(ThreadGroupObject *group, uint64_t needed) {
+	if (group->heap != NULL) {
+		heap_sweep(group->heap);
+		if (group->mem_used + needed <= group->mem_limit) {
+			return true;
+		}
+	}
+#ifndef GC_PRECISE_ROOTS
+	// a group which hasn't allocated since its last mark would only find the same things again
+	if (!gc_collecting && gc_can_collect_group(group)
+			&& !(group->gc_cycle == gc_stats.collections && group->gc_allocated == 0)) {
+		gc_collecting = true;
+		gc_collect_group(group);
+		gc_collecting = false;
+		if (group->mem_used + needed <= group->mem_limit) {
+			return true;
+		}
+	}
+#endif
+	gc_finish_sweep();
+	if (group->mem_used + needed <= group->mem_limit) {
+		return true;
+	}
+#ifndef GC_PRECISE_ROOTS
+	// if nothing has been allocated since the last mark, marking again would find the same things
+	if (!gc_collecting && gc_stats.bytes_since_gc != 0) {
+		gc_collecting = true;
+		gc_pending = GC_TRIGGER_QUOTA;
+		gc_collect();
+		gc_finish_sweep();
+		gc_collecting = false;
+	}
+#endif
+	return group->mem_used + needed <= group->mem_limit;
+}
+
+/////////////////////////////////////
+/// allocation
+/////////////////////////////////////
+
 void gc_init() {
+	char *gogc = getenv("OLY_GOGC");
+	if (gogc != NULL) {
+		// "off" or 0 turns automatic collection off
+		gc_stats.gogc = strcmp(gogc, "off") == 0 ? 0 : strtoull(gogc, NULL, 10);
+	}
+	char *hugepages = getenv("OLY_HUGEPAGES");
+	arena_hugepages = hugepages != NULL && strcmp(hugepages, "0") != 0;
+
+	// static objects are immortal and always marked, so tracing stops as soon as it reaches one.
+	// the only ones which can lead back into the heap are the ones with dicts.
+	static_roots = global_alloc(sizeof(Object*) * (&__stop_static_objects - &__start_static_objects));
+	if (static_roots == NULL) {
+		puts("Fatal error: could not allocate static roots");
+		abort();
+	}
 	for (Object **iter = &__start_static_objects; iter != &__stop_static_objects; iter++) {
-		gc_add(*iter);
-		gc_root(*iter);
+		Object *obj = *iter;
+		obj->gc_flags |= GC_IMMORTAL | GC_MARKED;
+		if (obj->table_id == TABLE_DICTO || obj->table_id == TABLE_OBJECT || obj->table_id == TABLE_TYPE) {
+			static_roots[static_roots_len++] = obj;
+		}
 	}
 }
 
+bool gc_register_group(ThreadGroupObject *group) {
+	uint32_t id;
+	if (free_group_ids_len) {
+		id = free_group_ids[--free_group_ids_len];
+	} else {
+		if (next_group_id == thread_groups_cap) {
+			size_t new_cap = thread_groups_cap * 2;
+			ThreadGroupObject **new_groups = global_alloc(sizeof(ThreadGroupObject*) * new_cap);
+			if (new_groups == NULL) {
+				return false;
+			}
+			memcpy(new_groups, thread_groups, sizeof(ThreadGroupObject*) * thread_groups_cap);
+			if (thread_groups != root_group_slot) {
+				global_dealloc(thread_groups, sizeof(ThreadGroupObject*) * thread_groups_cap);
+			}
+			thread_groups = new_groups;
+			thread_groups_cap = new_cap;
+		}
+		id = next_group_id++;
+	}
+	thread_groups[id] = group;
+	group->id = id;
+	// the region has to exist from the start, since its going away is how we find out the id is free
+	if (heap_of(group) == NULL) {
+		gc_unregister_group(group);
+		return false;
+	}
+	return true;
+}
+
+void gc_unregister_group(ThreadGroupObject *group) {
+	thread_groups[group->id] = NULL;
+	if (free_group_ids_len == free_group_ids_cap) {
+		size_t new_cap = free_group_ids_cap * 2 + 16;
+		uint32_t *new_ids = realloc(free_group_ids, sizeof(uint32_t) * new_cap);
+		if (new_ids == NULL) {
+			// just never reuse this one
+			return;
+		}
+		free_group_ids = new_ids;
+		free_group_ids_cap = new_cap;
+	}
+	free_group_ids[free_group_ids_len++] = group->id;
+}
+
 Object *gc_alloc(size_t size) {
 	return gc_alloc_ex(size, CURRENT_GROUP);
 }
 
-Object *gc_alloc_ex(size_t size, ThreadGroupObject *group) {
-	Object *result = quota_alloc(size, group);
-	if (!result) {
+Object *gc_alloc_inner(size_t size, ThreadGroupObject *group, size_t clear) {
+	if (group->mem_used + size > group->mem_limit && !gc_reclaim(group, size)) {
 		return NULL;
 	}
-	result->table = NULL;
-	result->group = group;
-	if (!gc_add(result)) {
-		quota_dealloc(result, size, group);
+	Object *result = region_alloc(group, size, SLOT_LIVE, clear);
+	if (!result) {
 		return NULL;
 	}
+	group->mem_used += size;
+	gc_pace(size, group);
+	result->group_id = group->id;
 	return result;
 }
 
-bool gc_phase1_unmark(void *key, void **val) {
-	*val = (void*)0;
+Object *gc_alloc_ex(size_t size, ThreadGroupObject *group) {
+	return gc_alloc_inner(size, group, size);
+}
+
+Object *gc_alloc_uninit(size_t size) {
+	// the header still has to be clean. the collector can see the object before it's filled in
+	return gc_alloc_inner(size, CURRENT_GROUP, sizeof(ObjectHeader));
+}
+
+void gc_donating(Object *obj) {
+	if (GROUP(obj)->heap != NULL) {
+		GROUP(obj)->heap->donated = true;
+	}
+	// it stays where it is, so whatever its new group gives it points out of its region
+	gc_remember(obj);
+}
+
+void gc_remember(Object *holder) {
+	if (holder->gc_flags & GC_REMEMBERED) {
+		return;
+	}
+	if (!queue_push(&remembered, holder)) {
+		remembered_lost = true;
+		return;
+	}
+	holder->gc_flags |= GC_REMEMBERED;
+}
+
+void gc_write_all(Object *holder, Object **data, size_t len) {
+	for (size_t i = 0; i < len && !(holder->gc_flags & GC_REMEMBERED); i++) {
+		GC_WRITE(holder, data[i]);
+	}
+}
+
+bool gc_walk(bool (*visitor)(Object *obj)) {
+	bool visit_page(GcPage *page) {
+		for (size_t idx = 0; idx < page->slot_count; idx++) {
+			if (page->state[idx] == SLOT_LIVE) {
+				if (!visitor((Object*)(page->slots + idx * page->slot_size))) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+	for (GcHeap *heap = gc_heaps; heap; heap = heap->next) {
+		for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+			for (GcPage *page = heap->size_classes[i].pages; page; page = page->next) {
+				if (!visit_page(page)) return false;
+			}
+		}
+		for (GcPage *page = heap->large_pages; page; page = page->next) {
+			if (!visit_page(page)) return false;
+		}
+	}
 	return true;
 }
 
-bool gc_phase2_2_mark(Object *obj) {
-	if (obj->table == NULL) {
-		puts("Fatal error: gc is processing an uninitialized object");
-		abort();
+bool gc_walk_groups(bool (*visitor)(ThreadGroupObject *group)) {
+	for (uint32_t id = 0; id < next_group_id; id++) {
+		if (thread_groups[id] != NULL && !visitor(thread_groups[id])) {
+			return false;
+		}
 	}
+	return true;
+}
 
-	GetResult get = dict_get(&all_objects, obj, gc_hasher, gc_equals);
-	if (!get.success) {
-		puts("Fatal error: this should never happen");
-		abort();
+// the pending sweep is finished first, so these are what the last collection found live plus
+// whatever has been allocated since
+bool gc_count_types(DictCore *counts) {
+	gc_finish_sweep();
+	bool visitor(Object *obj) {
+		GetResult get = dict_get(counts, obj->type, gc_hasher, gc_equals);
+		uintptr_t count = get.found ? (uintptr_t)get.val : 0;
+		return dict_set(counts, obj->type, (void*)(count + 1), gc_hasher, gc_equals, global_alloc, global_dealloc);
 	}
-	if (!get.found) {
-		puts("Fatal error: gc found an untracked object during tracing");
+	return gc_walk(visitor);
+}
+
+// types don't know their names, but the builtin ones can be found in builtins
+BytesObject *gc_type_name(TypeObject *type) {
+	BytesObject *name = NULL;
+	bool find_name(void *key, void **val) {
+		if (*val == type && ((Object*)key)->type == &g_bytes) {
+			name = (BytesObject*)key;
+			return false;
+		}
+		return true;
+	}
+	dict_trace(&builtins.core, find_name);
+	return name;
+}
+
+typedef struct GcTypeCount {
+	TypeObject *type;
+	uintptr_t count;
+} GcTypeCount;
+
+int gc_type_count_cmp(const void *a, const void *b) {
+	uintptr_t count_a = ((GcTypeCount*)a)->count, count_b = ((GcTypeCount*)b)->count;
+	return count_a < count_b ? 1 : count_a > count_b ? -1 : 0;
+}
+
+void gc_report(FILE *fp) {
+	fprintf(fp, "gc: %lu collections (%lu explicit, %lu heap, %lu group, %lu quota)\n",
+		gc_stats.collections,
+		gc_stats.collections_by_trigger[GC_TRIGGER_EXPLICIT],
+		gc_stats.collections_by_trigger[GC_TRIGGER_HEAP],
+		gc_stats.collections_by_trigger[GC_TRIGGER_GROUP],
+		gc_stats.collections_by_trigger[GC_TRIGGER_QUOTA]);
+	fprintf(fp, "gc: %lu collections of a single group's region, %lu objects remembered for them\n", gc_stats.group_collections, (uint64_t)remembered.len);
+	fprintf(fp, "gc: paused %.3fms in total, %.3fms at most\n", gc_stats.pause_ns / 1e6, gc_stats.max_pause_ns / 1e6);
+	fprintf(fp, "gc: %lu bytes allocated, %lu bytes and %lu objects freed\n", gc_stats.bytes_allocated, gc_stats.bytes_freed, gc_stats.objects_freed);
+	fprintf(fp, "gc: %lu bytes live at the last collection, %lu mapped, %lu returned to the os\n", gc_stats.live_bytes, gc_stats.mapped_bytes, gc_stats.bytes_returned);
+
+	bool print_group(ThreadGroupObject *group) {
+		fprintf(fp, "gc: group %u uses %lu of %lu bytes\n", group->id, group->mem_used, group->mem_limit);
+		return true;
+	}
+	gc_walk_groups(print_group);
+
+	DictCore counts = {0};
+	if (!gc_count_types(&counts)) {
+		fprintf(fp, "gc: could not count objects by type\n");
+		dict_destruct(&counts, global_dealloc);
+		return;
+	}
+	GcTypeCount *sorted = global_alloc(sizeof(GcTypeCount) * counts.len);
+	size_t sorted_len = 0;
+	bool gather(void *key, void **val) {
+		sorted[sorted_len++] = (GcTypeCount) { (TypeObject*)key, (uintptr_t)*val };
+		return true;
+	}
+	if (sorted != NULL) {
+		dict_trace(&counts, gather);
+		qsort(sorted, sorted_len, sizeof(GcTypeCount), gc_type_count_cmp);
+	}
+	for (size_t i = 0; i < sorted_len; i++) {
+		BytesObject *name = gc_type_name(sorted[i].type);
+		if (name != NULL) {
+			fprintf(fp, "gc: %lu %.*s\n", sorted[i].count, (int)name->len, bytes_data(name));
+		} else {
+			fprintf(fp, "gc: %lu <type %p>\n", sorted[i].count, sorted[i].type);
+		}
+	}
+	if (sorted != NULL) {
+		global_dealloc(sorted, sizeof(GcTypeCount) * counts.len);
+	}
+	dict_destruct(&counts, global_dealloc);
+}
+
+/////////////////////////////////////
+/// marking
+/////////////////////////////////////
+
+bool gc_mark(Object *obj) {
+	if (obj->table_id == TABLE_UNSET) {
+		puts("Fatal error: gc is processing an uninitialized object");
 		abort();
 	}
-	if (get.val) {
+	if (obj->gc_flags & GC_MARKED) {
 		return true;
 	}
+	obj->gc_flags |= GC_MARKED;
+	if (obj->table_id == TABLE_WEAKREF || obj->table_id == TABLE_WEAKDICT) {
+		if (!queue_push(&weak_queue, obj)) {
+			puts("Fatal error: could not queue weak reference");
+			abort();
+		}
+	}
+
+	ThreadGroupObject *group = GROUP(obj);
+	size_t obj_size = size(obj);
+	gc_stats.live_bytes += obj_size;
+	if (group->gc_cycle != gc_stats.collections) {
+		group->gc_cycle = gc_stats.collections;
+		group->gc_live = 0;
+		group->gc_allocated = 0;
+	}
+	group->gc_live += obj_size;
 
+	return trace(obj, gc_mark);
+}
 
-	if (!dict_set(&all_objects, obj, (void*)1, gc_hasher, gc_equals, global_alloc, global_dealloc)) {
-		puts("Fatal error: gc could not mark object");
+bool gc_mark_root(void *key, void **val) {
+	gc_mark((Object*)key);
+	return true;
+}
+
+#ifndef GC_PRECISE_ROOTS
+GcStack *gc_stacks = NULL;
+__thread GcStack gc_stack;
+
+void gc_register_stack() {
+	pthread_attr_t attr;
+	void *addr;
+	size_t size;
+	if (pthread_getattr_np(pthread_self(), &attr) != 0 || pthread_attr_getstack(&attr, &addr, &size) != 0) {
+		puts("Fatal error: could not find the thread's stack");
 		abort();
 	}
+	pthread_attr_destroy(&attr);
+
+	gc_stack.top = (char*)addr + size;
+	gc_stack.sp = NULL;
+	gc_stack.pending_error = &error;
+	gc_stack.stand_in = (Object*)&exc_pending;
+	gc_stack.pending_arg = &exc_pending_arg;
+	gc_stack.prev = NULL;
+	gc_stack.next = gc_stacks;
+	if (gc_stacks) {
+		gc_stacks->prev = &gc_stack;
+	}
+	gc_stacks = &gc_stack;
+}
+
+void gc_unregister_stack() {
+	if (gc_stack.prev) {
+		gc_stack.prev->next = gc_stack.next;
+	} else {
+		gc_stacks = gc_stack.next;
+	}
+	if (gc_stack.next) {
+		gc_stack.next->prev = gc_stack.prev;
+	}
+}
+
+// anything below the caller's frame
+__attribute__((noinline)) char *gc_stack_pointer() {
+	return __builtin_frame_address(0);
+}
 
-	return trace(obj, gc_phase2_2_mark);
+void gc_park_stack_at(char *sp) {
+	gc_stack.sp = sp;
 }
 
-bool gc_phase2_1_mark(void *key, void **val) {
-	gc_phase2_2_mark((Object*)key);
+// the live object this word might be pointing into
+Object *gc_object_at(void *word) {
+	GcPage *page = page_of(word);
+	if (page == NULL || (char*)word < page->slots) {
+		return NULL;
+	}
+	size_t idx = slot_index(page, word);
+	if (idx >= page->slot_count || page->state[idx] != SLOT_LIVE) {
+		return NULL;
+	}
+	return (Object*)(page->slots + idx * page->slot_size);
+}
+
+// mark whatever this word might be pointing into
+bool gc_mark_word(void *word) {
+	Object *obj = gc_object_at(word);
+	if (obj == NULL) {
+		return true;
+	}
+	if (obj->table_id == TABLE_UNSET) {
+		// someone is still filling this in. keep it, but there is nothing to trace yet except its group
+		obj->gc_flags |= GC_MARKED;
+		return gc_mark((Object*)GROUP(obj));
+	}
+	return gc_mark(obj);
+}
+
+// this reads all over other frames, which would upset the address sanitizer
+__attribute__((no_sanitize_address)) bool gc_scan_range(char *lo, char *hi, bool (*visitor)(void *word)) {
+	for (void **word = (void**)(((uintptr_t)lo + sizeof(void*) - 1) & ~(sizeof(void*) - 1)); (char*)(word + 1) <= hi; word++) {
+		if (!visitor(*word)) {
+			return false;
+		}
+	}
 	return true;
 }
 
-bool gc_phase3_finalize(void *key, void **val) {
-	Object *obj = (Object*)key;
-	if (!*val) {
-		obj->table->finalize(obj);
+// every word on every registered stack, and every thread's pending error
+bool gc_scan_stacks(bool (*visitor)(void *word)) {
+	// spill our own callee-saved registers into this frame, the same as parked threads did
+	__builtin_unwind_init();
+	gc_stack.sp = gc_stack_pointer();
+	for (GcStack *stack = gc_stacks; stack; stack = stack->next) {
+		if (stack->sp != NULL && !gc_scan_range(stack->sp, stack->top, visitor)) {
+			return false;
+		}
+		if (*stack->pending_error != NULL && !visitor(*stack->pending_error)) {
+			return false;
+		}
+		if (*stack->pending_error == stack->stand_in && *stack->pending_arg != NULL && !visitor(*stack->pending_arg)) {
+			return false;
+		}
 	}
 	return true;
 }
+#endif
+
+// whether the holder still has references out of its region. a donated object is always counted,
+// since its region belongs to someone else
+bool remembered_crosses(Object *holder) {
+	GcPage *page = page_of(holder);
+	if (page != NULL && page->heap != GROUP(holder)->heap) {
+		return true;
+	}
+	bool same_group(Object *obj) {
+		return obj->group_id == holder->group_id;
+	}
+	if (holder->table_id == TABLE_WEAKREF) {
+		Object *target = ((WeakRefObject*)holder)->target;
+		return target != NULL && !same_group(target);
+	}
+	if (holder->table_id == TABLE_WEAKDICT) {
+		bool entry(void *key, void **val) {
+			return same_group((Object*)key) && same_group((Object*)*val);
+		}
+		return !dict_trace(&((WeakDictObject*)holder)->header_dict.core, entry);
+	}
+	// the type and group are left out on purpose: those are never collected by a single region
+	return !TABLE(holder)->trace(holder, same_group);
+}
+
+// once a full mark is done, forget the holders which are dead or don't hold anything across
+// anymore. if one was ever lost, find them all again
+void remembered_prune() {
+	size_t kept = 0;
+	for (size_t i = 0; i < remembered.len; i++) {
+		Object *holder = remembered.data[i];
+		if ((holder->gc_flags & GC_MARKED) && remembered_crosses(holder)) {
+			remembered.data[kept++] = holder;
+		} else {
+			holder->gc_flags &= ~GC_REMEMBERED;
+		}
+	}
+	remembered.len = kept;
+
+	if (remembered_lost) {
+		remembered_lost = false;
+		bool visitor(Object *obj) {
+			if ((obj->gc_flags & GC_MARKED) && obj->table_id != TABLE_UNSET && remembered_crosses(obj)) {
+				gc_remember(obj);
+			}
+			return true;
+		}
+		gc_walk(visitor);
+	}
+}
+
+GcHeap *scoped_region = NULL; // being collected by gc_collect_group
+uint64_t scoped_live;
+
+bool in_region(Object *obj) {
+	GcPage *page = page_of(obj);
+	return page != NULL && page->heap == scoped_region;
+}
 
-bool gc_phase4_dispose(void *key, void *val) {
-	Object *object = (Object*)key;
-	if (!val) {
-		quota_dealloc(object, size(object), object->group);
+// like gc_mark, but nothing outside the region is marked or traced
+bool gc_mark_scoped(Object *obj) {
+	if ((obj->gc_flags & GC_MARKED) || !in_region(obj)) {
 		return true;
 	}
-	return false;
+	if (obj->table_id == TABLE_UNSET) {
+		puts("Fatal error: gc is processing an uninitialized object");
+		abort();
+	}
+	obj->gc_flags |= GC_MARKED;
+	if (obj->table_id == TABLE_WEAKREF || obj->table_id == TABLE_WEAKDICT) {
+		if (!queue_push(&weak_queue, obj)) {
+			puts("Fatal error: could not queue weak reference");
+			abort();
+		}
+	}
+	scoped_live += size(obj);
+	return trace(obj, gc_mark_scoped);
+}
+
+#ifndef GC_PRECISE_ROOTS
+bool gc_mark_word_scoped(void *word) {
+	Object *obj = gc_object_at(word);
+	if (obj == NULL || !in_region(obj)) {
+		return true;
+	}
+	if (obj->table_id == TABLE_UNSET) {
+		obj->gc_flags |= GC_MARKED;
+		return gc_mark_scoped((Object*)GROUP(obj));
+	}
+	return gc_mark_scoped(obj);
+}
+#endif
+
+// a region can be collected by itself when everything pointing into it from outside is known: the
+// remembered holders, plus the roots. nothing can have been donated out of it, since those objects
+// are pointed to from their new group without any barrier noticing.
+bool gc_can_collect_group(ThreadGroupObject *group) {
+	return group != &root_threadgroup && group->heap != NULL && !group->heap->donated
+		&& !group->heap->orphaned && !remembered_lost;
+}
+
+void gc_collect_group(ThreadGroupObject *group) {
+	if (!gc_can_collect_group(group)) {
+		gc_collect();
+		return;
+	}
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	gc_stats.group_collections++;
+
+	// the region's pages have to lose the last full mark's bits first
+	GcHeap *region = group->heap;
+	heap_sweep(region);
+	scoped_region = region;
+	scoped_live = 0;
+
+	// static objects which point in here are remembered like any other holder
+	bool mark_root(void *key, void **val) {
+		return gc_mark_scoped((Object*)key);
+	}
+	dict_trace(&roots, mark_root);
+#ifndef GC_PRECISE_ROOTS
+	gc_scan_stacks(gc_mark_word_scoped);
+#endif
+	// nothing keeps track of who has an object of a type, or who belongs to a group, so those stay
+	void mark_pinned(GcPage *page) {
+		for (size_t idx = 0; idx < page->slot_count; idx++) {
+			Object *obj = (Object*)(page->slots + idx * page->slot_size);
+			if (page->state[idx] == SLOT_LIVE && (obj->table_id == TABLE_TYPE || obj->table_id == TABLE_THREADGROUP)) {
+				gc_mark_scoped(obj);
+			}
+		}
+	}
+	for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+		for (GcPage *page = region->size_classes[i].pages; page; page = page->next) {
+			mark_pinned(page);
+		}
+	}
+	for (GcPage *page = region->large_pages; page; page = page->next) {
+		mark_pinned(page);
+	}
+	for (size_t i = 0; i < remembered.len; i++) {
+		if (!in_region(remembered.data[i])) {
+			trace(remembered.data[i], gc_mark_scoped);
+		}
+	}
+	type_cache_invalidate();
+
+	bool dead(Object *obj) {
+		return in_region(obj) && !(obj->gc_flags & GC_MARKED);
+	}
+	for (size_t i = 0; i < weak_queue.len; i++) {
+		weak_clear(weak_queue.data[i], dead);
+	}
+	weak_queue.len = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < remembered.len; i++) {
+		Object *holder = remembered.data[i];
+		if (!in_region(holder)) {
+			if (holder->table_id == TABLE_WEAKREF || holder->table_id == TABLE_WEAKDICT) {
+				weak_clear(holder, dead);
+			}
+		} else if (!(holder->gc_flags & GC_MARKED)) {
+			holder->gc_flags &= ~GC_REMEMBERED;
+			continue;
+		}
+		remembered.data[kept++] = holder;
+	}
+	remembered.len = kept;
+
+	for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+		for (GcPage *page = region->size_classes[i].pages; page; page = page->next) {
+			sweep_slots(page);
+		}
+	}
+	for (GcPage *page = region->large_pages, *next; page; page = next) {
+		next = page->next;
+		sweep_slots(page);
+	}
+	scoped_region = NULL;
+
+	group->gc_cycle = gc_stats.collections;
+	group->gc_live = scoped_live;
+	group->gc_allocated = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uint64_t pause = (end.tv_sec - start.tv_sec) * 1000000000ull + end.tv_nsec - start.tv_nsec;
+	gc_stats.pause_ns += pause;
+	if (pause > gc_stats.max_pause_ns) {
+		gc_stats.max_pause_ns = pause;
+	}
 }
 
 void gc_collect() {
-	// unmark all_objects
-	dict_trace(&all_objects, gc_phase1_unmark);
-	// mark roots
-	dict_trace(&roots, gc_phase2_1_mark);
-	// finalize unmarked objects
-	dict_trace(&all_objects, gc_phase3_finalize);
-	// dispose of unmarked objects
-	dict_popwhere(&all_objects, gc_phase4_dispose, global_dealloc);
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	gc_request(GC_TRIGGER_EXPLICIT);
+	gc_stats.collections++;
+	gc_stats.collections_by_trigger[gc_pending]++;
+	gc_stats.last_trigger = gc_pending;
+	gc_pending = GC_TRIGGER_NONE;
+
+	// the previous cycle's marks live on until its sweep is done
+	gc_finish_sweep();
+
+	gc_stats.live_bytes = 0;
+	for (size_t i = 0; i < static_roots_len; i++) {
+		trace(static_roots[i], gc_mark);
+	}
+	dict_trace(&roots, gc_mark_root);
+#ifndef GC_PRECISE_ROOTS
+	gc_scan_stacks(gc_mark_word);
+#endif
+	type_cache_invalidate();
+	// everything reachable is marked now, so anything else a weak reference points at is dead
+	bool unmarked(Object *obj) {
+		return !(obj->gc_flags & GC_MARKED);
+	}
+	for (size_t i = 0; i < weak_queue.len; i++) {
+		weak_clear(weak_queue.data[i], unmarked);
+	}
+	weak_queue.len = 0;
+	remembered_prune();
+	shape_purge();
+
+	gc_stats.bytes_since_gc = 0;
+	gc_stats.next_gc = gc_stats.live_bytes / 100 * gc_stats.gogc;
+	if (gc_stats.next_gc < GC_MIN_GOAL) {
+		gc_stats.next_gc = GC_MIN_GOAL;
+	}
+
+	// every page is unswept now. the sweeping happens bit by bit as the allocator needs space
+	gc_epoch++;
+	sweep_pending = page_count;
+	purge_pending = true;
+	for (GcHeap *heap = gc_heaps; heap; heap = heap->next) {
+		heap->orphaned = !(heap->owner->header.gc_flags & GC_MARKED);
+		heap->doomed = heap->orphaned && !heap->donated;
+		for (size_t i = 0; i < GC_NUM_CLASSES; i++) {
+			heap->size_classes[i].sweep_cursor = heap->size_classes[i].pages;
+			heap->size_classes[i].current = NULL;
+		}
+		heap->large_cursor = heap->large_pages;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uint64_t pause = (end.tv_sec - start.tv_sec) * 1000000000ull + end.tv_nsec - start.tv_nsec;
+	gc_stats.pause_ns += pause;
+	if (pause > gc_stats.max_pause_ns) {
+		gc_stats.max_pause_ns = pause;
+	}
 }
 
+void gc_dump_pending();
+
 void gc_probe() {
-	// TODO uhhhhhhhhhhhhhhh heuristics
-	static int gc_counter = 0;
-	gc_counter++;
-	if (gc_counter == 1000) {
-		gc_counter = 0;
+	if (gc_dump_requested) {
+		gc_dump_pending();
+	}
+	if (gc_pending == GC_TRIGGER_GROUP && gc_pending_group < next_group_id && thread_groups[gc_pending_group] != NULL) {
+		// only the one group is over its goal. if its region can't be collected alone, this is a
+		// full collection, which takes the trigger with it
+		gc_collect_group(thread_groups[gc_pending_group]);
+		gc_pending = GC_TRIGGER_NONE;
+	} else if (gc_pending != GC_TRIGGER_NONE) {
 		gc_collect();
 	}
+	if (!reclaimer_started) {
+		gc_run_finalizers(GC_FINALIZE_BATCH);
+	}
 }
 
-// TODO this is technically not correct - we need to store a mapping from object to *number of roots*
-// so that if you root an object twice and unroot it once it's still rooted
-// this is notably a problem with the empty tuple
+// roots are counted, so that if you root an object twice and unroot it once it's still rooted.
+// this matters for shared objects like the empty tuple
 bool gc_root(Object *obj) {
-	bool result = dict_set(&roots, obj, NULL, gc_hasher, gc_equals, global_alloc, global_dealloc);
-	return result;
+	GetResult get = dict_get(&roots, obj, gc_hasher, gc_equals);
+	uintptr_t count = get.found ? (uintptr_t)get.val : 0;
+	return dict_set(&roots, obj, (void*)(count + 1), gc_hasher, gc_equals, global_alloc, global_dealloc);
 }
 
 bool gc_unroot(Object *obj) {
+	GetResult get = dict_get(&roots, obj, gc_hasher, gc_equals);
+	if (!get.found) {
+		return false;
+	}
+	if ((uintptr_t)get.val > 1) {
+		return dict_set(&roots, obj, (void*)((uintptr_t)get.val - 1), gc_hasher, gc_equals, global_alloc, global_dealloc);
+	}
 	GetResult result = dict_pop(&roots, obj, gc_hasher, gc_equals, global_dealloc);
 	if (!result.success) {
 		puts("This should never happen");
@@ -204,3 +1772,114 @@ bool gc_unroot(Object *obj) {
 	}
 	return result.found;
 }
+
+/////////////////////////////////////
+/// heap dumps
+/////////////////////////////////////
+
+// a dump is the magic and a version, then records which each start with a tag byte. all numbers are
+// little endian, and objects and types are named by their addresses:
+//   'T' type: u64 type, u32 name length, name. only for types with names
+//   'O' object: u64 object, u64 type, u32 group, u64 size, u32 reference count, u64 references...
+//   'R' root: u64 object
+//   'E' the end
+// only what a fresh collection leaves in the heap is written, so every object is live. references to
+// objects that aren't in the dump, like static ones, are left in for the reader to ignore.
+#define GC_DUMP_MAGIC "OLYHEAP"
+#define GC_DUMP_VERSION 1
+
+bool gc_dump(FILE *fp) {
+	gc_collect();
+	gc_finish_sweep();
+
+	bool put(const void *data, size_t len) {
+		return fwrite(data, 1, len, fp) == len;
+	}
+	bool put_u32(uint32_t val) { return put(&val, sizeof(val)); }
+	bool put_u64(uint64_t val) { return put(&val, sizeof(val)); }
+	bool put_root(Object *obj) {
+		return obj->table_id == TABLE_UNSET || (put("R", 1) && put_u64((uintptr_t)obj));
+	}
+	bool put_root_key(void *key, void **val) {
+		return put_root((Object*)key);
+	}
+
+	if (!put(GC_DUMP_MAGIC, sizeof(GC_DUMP_MAGIC)) || !put_u32(GC_DUMP_VERSION)) {
+		return false;
+	}
+
+	DictCore types = {0};
+	bool put_object(Object *obj) {
+		if (obj->table_id == TABLE_UNSET) {
+			return true;
+		}
+		if (!dict_get(&types, obj->type, gc_hasher, gc_equals).found) {
+			BytesObject *name = gc_type_name(obj->type);
+			if (!dict_set(&types, obj->type, NULL, gc_hasher, gc_equals, global_alloc, global_dealloc)) {
+				return false;
+			}
+			if (name != NULL && !(put("T", 1) && put_u64((uintptr_t)obj->type) && put_u32(name->len) && put(bytes_data(name), name->len))) {
+				return false;
+			}
+		}
+		uint32_t count = 0;
+		bool count_ref(Object *ref) {
+			count++;
+			return true;
+		}
+		bool put_ref(Object *ref) {
+			return put_u64((uintptr_t)ref);
+		}
+		trace(obj, count_ref);
+		return put("O", 1)
+			&& put_u64((uintptr_t)obj)
+			&& put_u64((uintptr_t)obj->type)
+			&& put_u32(obj->group_id)
+			&& put_u64(size(obj))
+			&& put_u32(count)
+			&& trace(obj, put_ref);
+	}
+	bool ok = gc_walk(put_object);
+	dict_destruct(&types, global_dealloc);
+	if (!ok) {
+		return false;
+	}
+
+	// the same roots the mark starts from
+	for (size_t i = 0; i < static_roots_len; i++) {
+		if (!trace(static_roots[i], put_root)) {
+			return false;
+		}
+	}
+	if (!dict_trace(&roots, put_root_key)) {
+		return false;
+	}
+#ifndef GC_PRECISE_ROOTS
+	bool put_word(void *word) {
+		Object *obj = gc_object_at(word);
+		return obj == NULL || put_root(obj);
+	}
+	if (!gc_scan_stacks(put_word)) {
+		return false;
+	}
+#endif
+	return put("E", 1) && fflush(fp) == 0;
+}
+
+// what a signal asked for. goes to $OLY_HEAPDUMP, or oly-<pid>.heap
+void gc_dump_pending() {
+	gc_dump_requested = 0;
+	char path[64];
+	char *dest = getenv("OLY_HEAPDUMP");
+	if (dest == NULL) {
+		snprintf(path, sizeof(path), "oly-%d.heap", getpid());
+		dest = path;
+	}
+	FILE *fp = fopen(dest, "wb");
+	if (fp == NULL || !gc_dump(fp)) {
+		fprintf(stderr, "gc: could not write heap dump to %s\n", dest);
+	}
+	if (fp != NULL) {
+		fclose(fp);
+	}
+}
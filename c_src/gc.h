@@ -1,24 +1,126 @@
 #pragma once
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "object.h"
 
+typedef enum GcTrigger {
+	GC_TRIGGER_NONE,
+	GC_TRIGGER_EXPLICIT, // someone called gc_collect directly
+	GC_TRIGGER_HEAP,     // allocations since the last collection reached the pacer's goal
+	GC_TRIGGER_GROUP,    // a threadgroup used up half of its headroom
+	GC_TRIGGER_QUOTA,    // an allocation didn't fit in its group's quota
+} GcTrigger;
+
+typedef struct GcStats {
+	uint64_t collections;
+	uint64_t collections_by_trigger[5];
+	GcTrigger last_trigger;
+	uint64_t gogc;            // percent the heap may grow past the live size before the next collection
+	uint64_t bytes_allocated; // over the whole run
+	uint64_t bytes_since_gc;
+	uint64_t live_bytes;      // found by the last mark
+	uint64_t next_gc;         // bytes_since_gc at which the pacer will ask for a collection
+	uint64_t regions_released; // dead threadgroups whose regions were dropped whole
+	uint64_t mapped_bytes;     // held from the os for pages
+	uint64_t bytes_returned;   // handed back to the os over the whole run
+	uint64_t bytes_freed;      // given back by frees and sweeps over the whole run
+	uint64_t objects_freed;    // found dead by sweeps over the whole run
+	uint64_t pause_ns;         // spent in gc_collect over the whole run
+	uint64_t max_pause_ns;
+	uint64_t group_collections; // of a single group's region, which aren't counted in collections
+} GcStats;
+
+extern GcStats gc_stats;
+
 __attribute__((constructor)) void gc_init();
 Object *gc_alloc(size_t size);
 Object *gc_alloc_ex(size_t size, ThreadGroupObject *group);
+// only the header is cleared. for constructors which fill in every field
+Object *gc_alloc_uninit(size_t size);
 void gc_collect();
+// collect only the garbage in the group's region
+void gc_collect_group(ThreadGroupObject *group);
+bool gc_finish_sweep();
+// make room for needed more bytes in group. true if they fit now
+bool gc_reclaim(ThreadGroupObject *group, uint64_t needed);
 void gc_probe();
+void gc_request(GcTrigger trigger);
+bool gc_walk(bool (*visitor)(Object *obj));
+bool gc_walk_groups(bool (*visitor)(ThreadGroupObject *group));
+// count the heap's objects by type, as type -> count. frees with global_dealloc
+bool gc_count_types(DictCore *counts);
+// print gc_stats and what the heap holds
+void gc_report(FILE *fp);
+// collect, then write every live object and the roots to fp. the format is in gc.c
+bool gc_dump(FILE *fp);
+// a signal handler which asks for a dump at the next probe
+void gc_dump_signal(int sig);
+// call before moving an object to another group
+void gc_donating(Object *obj);
+// call after storing a reference in an object. the ones which point into another group are
+// remembered, so that the other group can be collected without tracing the holder's
+#define GC_WRITE(holder, val) ({ \
+	Object *_val = (Object*)(val); \
+	if (_val != NULL && ((Object*)(holder))->group_id != _val->group_id) { \
+		gc_remember((Object*)(holder)); \
+	} \
+})
+void gc_remember(Object *holder);
+void gc_write_all(Object *holder, Object **data, size_t len);
+// hand out a group id and a heap region
+bool gc_register_group(ThreadGroupObject *group);
+void gc_unregister_group(ThreadGroupObject *group);
 bool gc_root(Object *obj);
 bool gc_unroot(Object *obj);
 
 void *quota_alloc(size_t size, ThreadGroupObject *group);
+// the buffer isn't cleared
+void *quota_alloc_uninit(size_t size, ThreadGroupObject *group);
 void quota_dealloc(void *ptr, size_t size, ThreadGroupObject *group);
 void *quota_realloc(void *ptr, size_t newsize, size_t oldsize, ThreadGroupObject *group);
 void *current_thread_alloc(size_t size);
+void *current_thread_alloc_uninit(size_t size);
 void current_thread_dealloc(void *ptr, size_t size);
 void *current_thread_realloc(void *ptr, size_t newsize, size_t oldsize);
 void *global_alloc(size_t size);
 void global_dealloc(void *ptr, size_t size);
 
+// C code has two ways of keeping its temporaries alive across anything which might collect. by
+// default the collector scans every thread's stack and registers conservatively, so GC_TEMP_ROOT
+// and GC_TEMP_UNROOT cost nothing. build with -DGC_PRECISE_ROOTS to scan nothing and have them
+// register real roots instead. objects which must outlive the C frame that made them still need
+// gc_root either way.
+#ifdef GC_PRECISE_ROOTS
+#define GC_TEMP_ROOT(obj) gc_root(obj)
+#define GC_TEMP_UNROOT(obj) gc_unroot(obj)
+#define GC_PARK_STACK()
+#define GC_UNPARK_STACK()
+#else
+typedef struct GcStack {
+	struct GcStack *next, *prev;
+	char *top;      // the highest address of the thread's stack
+	char *sp;       // everything between here and top is scanned
+	Object **pending_error;
+	Object *stand_in;      // the thread's stand-in for a lazy error
+	Object **pending_arg;  // which has to be kept while the stand-in is pending
+} GcStack;
+
+// call with the gil held, once the thread is running and right before it exits
+void gc_register_stack();
+void gc_unregister_stack();
+char *gc_stack_pointer();
+void gc_park_stack_at(char *sp);
+
+#define GC_TEMP_ROOT(obj) ((void)(obj))
+#define GC_TEMP_UNROOT(obj) ((void)(obj))
+// use right before giving up the gil. the registers are spilled into the caller's frame, which
+// must stay live until the gil is back
+#define GC_PARK_STACK() ({ __builtin_unwind_init(); gc_park_stack_at(gc_stack_pointer()); })
+// use right after getting the gil back. otherwise the compiler is free to tail call whatever takes
+// the gil, which reuses the frame holding the spilled registers while the thread still waits
+#define GC_UNPARK_STACK() __asm__ volatile ("" ::: "memory")
+#endif
+
 #define STATIC_OBJECT(obj) static Object* static_##obj __attribute((used, section("static_objects"))) = ((Object*)&obj)
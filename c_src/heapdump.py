@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# reads a heap dump from gc.dump() or SIGUSR1 and reports what is holding on to memory.
+# usage: heapdump.py file.heap [count]
+
+import sys
+import struct
+from collections import defaultdict
+
+MAGIC = b'OLYHEAP\0'
+VERSION = 1
+
+def load(path):
+    data = open(path, 'rb').read()
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError('not a heap dump')
+    version, = struct.unpack_from('<I', data, len(MAGIC))
+    if version != VERSION:
+        raise ValueError('unknown heap dump version %d' % version)
+    pos = len(MAGIC) + 4
+
+    names = {}
+    objects = []  # (address, type, group, size, refs)
+    roots = []
+    while True:
+        tag = data[pos:pos + 1]
+        pos += 1
+        if tag == b'T':
+            ty, length = struct.unpack_from('<QI', data, pos)
+            pos += 12
+            names[ty] = data[pos:pos + length].decode(errors='replace')
+            pos += length
+        elif tag == b'O':
+            addr, ty, group, size, count = struct.unpack_from('<QQIQI', data, pos)
+            pos += 32
+            refs = struct.unpack_from('<%dQ' % count, data, pos)
+            pos += 8 * count
+            objects.append((addr, ty, group, size, refs))
+        elif tag == b'R':
+            roots.append(struct.unpack_from('<Q', data, pos)[0])
+            pos += 8
+        elif tag == b'E':
+            return names, objects, roots
+        else:
+            raise ValueError('bad record at %d' % (pos - 1))
+
+def dominators(succs, count):
+    # cooper, harvey and kennedy's iterative algorithm. node 0 is the root
+    order = []
+    seen = [False] * count
+    seen[0] = True
+    stack = [(0, iter(succs[0]))]
+    while stack:
+        node, it = stack[-1]
+        for nxt in it:
+            if not seen[nxt]:
+                seen[nxt] = True
+                stack.append((nxt, iter(succs[nxt])))
+                break
+        else:
+            stack.pop()
+            order.append(node)
+    order.reverse()
+    rpo = [0] * count
+    for i, node in enumerate(order):
+        rpo[node] = i
+    preds = [[] for _ in range(count)]
+    for node in order:
+        for nxt in succs[node]:
+            preds[nxt].append(node)
+
+    idom = [-1] * count
+    idom[0] = 0
+    def intersect(a, b):
+        while a != b:
+            while rpo[a] > rpo[b]:
+                a = idom[a]
+            while rpo[b] > rpo[a]:
+                b = idom[b]
+        return a
+    changed = True
+    while changed:
+        changed = False
+        for node in order[1:]:
+            new = -1
+            for pred in preds[node]:
+                if idom[pred] != -1:
+                    new = pred if new == -1 else intersect(pred, new)
+            if idom[node] != new:
+                idom[node] = new
+                changed = True
+    return order, idom
+
+def main():
+    path = sys.argv[1]
+    top = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+    names, objects, roots = load(path)
+
+    # node 0 stands for all the roots together
+    index = {obj[0]: i + 1 for i, obj in enumerate(objects)}
+    count = len(objects) + 1
+    succs = [sorted({index[r] for r in roots if r in index})]
+    for obj in objects:
+        succs.append([index[r] for r in obj[4] if r in index])
+    order, idom = dominators(succs, count)
+
+    def type_name(ty):
+        return names.get(ty, '<type %#x>' % ty)
+    def describe(node):
+        if node == 0:
+            return '(roots)'
+        addr, ty = objects[node - 1][:2]
+        return '%s@%#x' % (type_name(ty), addr)
+
+    # everything a node dominates is freed along with it
+    retained = [0] + [obj[3] for obj in objects]
+    for node in reversed(order[1:]):
+        retained[idom[node]] += retained[node]
+
+    # a type's retained size only counts the outermost object of that type on each path, so
+    # a list of lists isn't counted twice
+    children = defaultdict(list)
+    for node in order[1:]:
+        children[idom[node]].append(node)
+    by_type = defaultdict(lambda: [0, 0, 0])  # retained, shallow, count
+    open_types = defaultdict(int)
+    stack = [(0, False)]
+    while stack:
+        node, leaving = stack.pop()
+        ty = objects[node - 1][1] if node else None
+        if leaving:
+            open_types[ty] -= 1
+            continue
+        if node:
+            entry = by_type[ty]
+            if open_types[ty] == 0:
+                entry[0] += retained[node]
+            entry[1] += objects[node - 1][3]
+            entry[2] += 1
+            open_types[ty] += 1
+            stack.append((node, True))
+        stack.extend((child, False) for child in children[node])
+
+    unreachable = count - len(order)
+    print('%d objects, %d bytes, %d bytes reachable from %d roots' % (len(objects), sum(obj[3] for obj in objects), retained[0], len(succs[0])))
+    if unreachable:
+        print('%d objects not reachable from the roots' % unreachable)
+    print()
+    print('%12s %12s %10s  type' % ('retained', 'shallow', 'count'))
+    for ty, (ret, shallow, num) in sorted(by_type.items(), key=lambda item: -item[1][0])[:top]:
+        print('%12d %12d %10d  %s' % (ret, shallow, num, type_name(ty)))
+    print()
+    print('largest retained sizes, and what keeps them alive:')
+    for node in sorted(order[1:], key=lambda node: -retained[node])[:top]:
+        path = [node]
+        while path[-1] != 0:
+            path.append(idom[path[-1]])
+        print('%12d  %s' % (retained[node], ' <- '.join(describe(n) for n in path)))
+
+if __name__ == '__main__':
+    main()
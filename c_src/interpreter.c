@@ -158,37 +158,37 @@ Object *interpreter(ClosureObject *closure, TupleObject *args) {
 	if (locals == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)locals);
+	GC_TEMP_ROOT((Object*)locals);
 
 	ListObject *stack = list_raw(NULL, 0);
 	if (stack == NULL) {
-		gc_unroot((Object*)locals);
+		GC_TEMP_UNROOT((Object*)locals);
 		return NULL;
 	}
-	gc_root((Object*)stack);
+	GC_TEMP_ROOT((Object*)stack);
 
 	ListObject *temproot = list_raw(NULL, 0);
 	if (temproot == NULL) {
-		gc_unroot((Object*)stack);
-		gc_unroot((Object*)locals);
+		GC_TEMP_UNROOT((Object*)stack);
+		GC_TEMP_UNROOT((Object*)locals);
 		return NULL;
 	}
-	gc_root((Object*)temproot);
+	GC_TEMP_ROOT((Object*)temproot);
 
 	ListObject *trystack = list_raw(NULL, 0);
 	if (trystack == NULL) {
-		gc_unroot((Object*)stack);
-		gc_unroot((Object*)locals);
-		gc_unroot((Object*)temproot);
+		GC_TEMP_UNROOT((Object*)stack);
+		GC_TEMP_UNROOT((Object*)locals);
+		GC_TEMP_UNROOT((Object*)temproot);
 		return NULL;
 	}
-	gc_root((Object*)trystack);
+	GC_TEMP_ROOT((Object*)trystack);
 
 	const char *pointer = bytes_data(closure->bytecode);
 	Object *result = NULL;
 
 	while (true) {
-#define RESYNC_GROUP() ({ if (stack->header.group != CURRENT_GROUP) { donate_inner(CURRENT_GROUP, (Object*)stack); donate_inner(CURRENT_GROUP, (Object*)locals); donate_inner(CURRENT_GROUP, (Object*)temproot); donate_inner(CURRENT_GROUP, (Object*)trystack); }})
+#define RESYNC_GROUP() ({ if (GROUP(stack) != CURRENT_GROUP) { donate_inner(CURRENT_GROUP, (Object*)stack); donate_inner(CURRENT_GROUP, (Object*)locals); donate_inner(CURRENT_GROUP, (Object*)temproot); donate_inner(CURRENT_GROUP, (Object*)trystack); }})
 		while (temproot->len) {
 			if (!list_pop_back_inner(temproot)) {
 				puts("Fatal error: could not pop temproot");
@@ -211,7 +211,11 @@ Object *interpreter(ClosureObject *closure, TupleObject *args) {
 #define CHECK(_val) ({ __typeof__(_val) _evaluated = (_val); if (!_evaluated) { break; } RESYNC_GROUP(); _evaluated; })
 #define POP() ({ Object *_popped = list_pop_back_inner(stack); if (_popped == NULL) { error = exc_msg(&g_RuntimeError, "stack underflow"); goto ERROR; } _popped; })
 #define PUSH(_pushed) ({ if (!list_push_back_inner(stack, (Object*)_pushed)) { break; } })
+#ifdef GC_PRECISE_ROOTS
 #define TEMPROOT(_rooted) ({ if (!list_push_back_inner(temproot, (Object*)_rooted)) { break ; } })
+#else
+#define TEMPROOT(_rooted) ({ (void)(_rooted); })
+#endif
 #define NEXT_NUM_UNSIGNED() ({ uint64_t _lit; if (!next_num_unsigned(closure->bytecode, &pointer, &_lit)) { error = exc_msg(&g_RuntimeError, "out of bounds"); break; } _lit; })
 #define NEXT_NUM_SIGNED() ({ int64_t _lit; if (!next_num_signed(closure->bytecode, &pointer, &_lit)) { error = exc_msg(&g_RuntimeError, "out of bounds"); break; } _lit; })
 #define NEXT_FLOAT() ({ double _lit; if (!next_float(closure->bytecode, &pointer, &_lit)) { error = exc_msg(&g_RuntimeError, "out of bounds"); break; } _lit; })
@@ -575,6 +579,10 @@ ERROR:
 			// can't touch this
 			goto EXIT;
 		}
+		// popping an empty list raises, which would clobber a lazy error's stand-in
+		if (trystack->len == 0) {
+			goto EXIT;
+		}
 		_catch_target = list_pop_back_inner(trystack);
 		if (_catch_target == NULL) {
 			error = local_error;
@@ -590,6 +598,10 @@ ERROR:
 		while (stack->len) {
 			POP(); // this cannot trigger the error condition
 		}
+		// a for loop's catch only looks at the error's type, and lets anything but StopIteration go
+		if (catch_target >= closure->bytecode->len || *pointer != RAISE_IF_NOT_STOP) {
+			error = exc_materialize(error);
+		}
 		if (!list_push_back_inner(stack, error)) {
 			error = (Object*)&MemoryError_inst;
 			// disard the entire try stack and just bail out
@@ -599,9 +611,9 @@ ERROR:
 	}
 
 EXIT:
-	gc_unroot((Object*)stack);
-	gc_unroot((Object*)locals);
-	gc_unroot((Object*)temproot);
-	gc_unroot((Object*)trystack);
+	GC_TEMP_UNROOT((Object*)stack);
+	GC_TEMP_UNROOT((Object*)locals);
+	GC_TEMP_UNROOT((Object*)temproot);
+	GC_TEMP_UNROOT((Object*)trystack);
 	return result;
 }
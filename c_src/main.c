@@ -9,12 +9,13 @@
 #include "gc.h"
 #include "thread.h"
 
-extern DictCore all_objects, roots;
+extern DictCore roots;
 HashResult gc_hasher(void *val);
 EqualityResult gc_equals(void *val1, void *val2);
 
 int main(int argc, char **argv) {
 	signal(SIGPIPE, SIG_IGN); // uhhhhhhhhhhh
+	signal(SIGUSR1, gc_dump_signal);
 	if (argc < 2) {
 		printf("Usage: %s src.olc\n", argv[0]);
 		return 1;
@@ -45,39 +46,48 @@ int main(int argc, char **argv) {
 	TupleObject *argv_obj = tuple_raw(argv_converted, argc - 2);
 	ClosureObject *real_main = closure_raw(bytes, &builtins);
 
-	gc_root((Object*)real_main);
-	gc_root((Object*)argv_obj);
+	GC_TEMP_ROOT((Object*)real_main);
+	GC_TEMP_ROOT((Object*)argv_obj);
 	Object *result = call((Object*)real_main, argv_obj);
-	gc_unroot((Object*)real_main);
-	gc_unroot((Object*)argv_obj);
+	GC_TEMP_UNROOT((Object*)real_main);
+	GC_TEMP_UNROOT((Object*)argv_obj);
 
 	int retcode;
 	if (result == NULL) {
 		puts("Program aborted with error");
+		error = exc_materialize(error);
 		TupleObject *print_args = tuple_raw((Object*[]){error}, 1);
 		if (print_args == NULL) {
 			puts("Could not convert error to string?");
 			return 1;
 		}
-		gc_root((Object*)print_args);
+		GC_TEMP_ROOT((Object*)print_args);
 		if (builtin_print(print_args) == NULL) {
 			puts("Could not convert error to string");
 		}
-		gc_unroot((Object*)print_args);
+		GC_TEMP_UNROOT((Object*)print_args);
 		retcode = 1;
 	} else {
 		retcode = result->type == &g_int ? ((IntObject*)result)->value : 0;
 	}
+	if (getenv("OLY_GCSTATS") != NULL) {
+		gc_report(stderr);
+	}
+#ifndef GC_PRECISE_ROOTS
+	// nothing on the stack matters anymore, and stale pointers there would look like leaks
+	gc_unregister_stack();
+#endif
 	gc_collect();
+	gc_finish_sweep();
 	if (root_threadgroup.mem_used != 0) {
 		printf("remaining: %ld\n", root_threadgroup.mem_used);
-		//bool tracer(void *key, void **val) {
-		//	if (!dict_get(&roots, key, gc_hasher, gc_equals).found) {
-		//		printf("%p\n", key);
+		//bool tracer(Object *obj) {
+		//	if (!dict_get(&roots, obj, gc_hasher, gc_equals).found) {
+		//		printf("%p\n", obj);
 		//	}
 		//	return true;
 		//}
-		//dict_trace(&all_objects, tracer);
+		//gc_walk(tracer);
 		//abort();
 	}
 	return retcode;
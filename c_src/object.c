@@ -154,12 +154,36 @@ ObjectTable exc_table = {
 	.size.given = sizeof(ExceptionObject),
 };
 
+ObjectTable *object_tables[TABLE_COUNT] = {
+	[TABLE_NULL] = &null_table,
+	[TABLE_DICTO] = &dicto_table,
+	[TABLE_OBJECT] = &object_table,
+	[TABLE_TYPE] = &type_table,
+	[TABLE_INT] = &int_table,
+	[TABLE_FLOAT] = &float_table,
+	[TABLE_LIST] = &list_table,
+	[TABLE_TUPLE] = &tuple_table,
+	[TABLE_BYTES] = &bytes_table,
+	[TABLE_BYTES_UNOWNED] = &bytes_unowned_table,
+	[TABLE_BYTEARRAY] = &bytearray_table,
+	[TABLE_BUILTINFUNCTION] = &builtinfunction_table,
+	[TABLE_CLOSURE] = &closure_table,
+	[TABLE_BOUNDMETH] = &boundmeth_table,
+	[TABLE_SLICE] = &slice_table,
+	[TABLE_EXC] = &exc_table,
+	[TABLE_LIST_ITERATOR] = &list_iterator_table,
+	[TABLE_THREAD] = &thread_table,
+	[TABLE_THREADGROUP] = &threadgroup_table,
+	[TABLE_WEAKREF] = &weakref_table,
+	[TABLE_WEAKDICT] = &weakdict_table,
+};
+
 // builtin type class instances
 
 
 Object *object_constructor(Object *self, TupleObject *args);
 TypeObject g_object = {
-	.header_basic.header_dict.header.table = &type_table,
+	.header_basic.header_dict.header.table_id = TABLE_TYPE,
 	.header_basic.header_dict.header.type = &g_type,
 	.base_class = NULL,
 	.constructor = object_constructor,
@@ -185,25 +209,25 @@ BUILTIN_TYPE(exception, object, exc_constructor);
 
 EmptyObject g_none = {
 	.header.type = &g_nonetype,
-	.header.table = &null_table,
+	.header.table_id = TABLE_NULL,
 };
 STATIC_OBJECT(g_none);
 ADD_MEMBER(builtins, "none", g_none);
 EmptyObject g_true = {
 	.header.type = &g_bool,
-	.header.table = &null_table,
+	.header.table_id = TABLE_NULL,
 };
 STATIC_OBJECT(g_true);
 ADD_MEMBER(builtins, "true", g_true);
 EmptyObject g_false = {
 	.header.type = &g_bool,
-	.header.table = &null_table,
+	.header.table_id = TABLE_NULL,
 };
 STATIC_OBJECT(g_false);
 ADD_MEMBER(builtins, "false", g_false);
 TupleObject empty_tuple = {
 	.header.type = &g_tuple,
-	.header.table = &tuple_table,
+	.header.table_id = TABLE_TUPLE,
 	.len = 0,
 };
 STATIC_OBJECT(empty_tuple);
@@ -215,15 +239,15 @@ void null_finalize(Object *self) {
 	return;
 }
 Object *null_get_attr(Object *self, Object *name) {
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 bool null_set_attr(Object *self, Object *name, Object *value) {
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 bool null_del_attr(Object *self, Object *name) {
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 Object *null_call(Object *self, TupleObject *args) {
@@ -232,12 +256,12 @@ Object *null_call(Object *self, TupleObject *args) {
 }
 
 IntObject *int_raw(int64_t value) {
-	IntObject *result = (IntObject *)gc_alloc(sizeof(IntObject));
+	IntObject *result = (IntObject *)gc_alloc_uninit(sizeof(IntObject));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
-	result->header.table = &int_table;
+	result->header.table_id = TABLE_INT;
 	result->header.type = &g_int;
 	result->value = value;
 	return result;
@@ -257,12 +281,12 @@ EmptyObject *bool_raw(bool value) {
 }
 
 FloatObject *float_raw(double value) {
-	FloatObject *result = (FloatObject*)gc_alloc(sizeof(IntObject));
+	FloatObject *result = (FloatObject*)gc_alloc_uninit(sizeof(FloatObject));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
-	result->header.table = &float_table;
+	result->header.table_id = TABLE_FLOAT;
 	result->header.type = &g_float;
 	result->value = value;
 	return result;
@@ -284,16 +308,18 @@ ListObject *list_raw(Object **data, size_t len) {
 		return NULL;
 	}
 	result->header.type = &g_list;
-	result->header.table = &list_table;
-	result->len = len;
-	result->cap = len;
-	result->data = current_thread_alloc(sizeof(Object*) * len);
-	if (!result->data) {
+	result->header.table_id = TABLE_LIST;
+	// the allocation may collect, so the list has to stay empty until the data is in
+	Object **buffer = current_thread_alloc_uninit(sizeof(Object*) * len);
+	if (!buffer) {
 		error = (Object*)&MemoryError_inst;
-		current_thread_dealloc(result, sizeof(ListObject));
 		return NULL;
 	}
-	memcpy(result->data, data, sizeof(Object*) * len);
+	memcpy(buffer, data, sizeof(Object*) * len);
+	result->data = buffer;
+	result->len = len;
+	result->cap = len;
+	gc_write_all((Object*)result, data, len);
 	return result;
 }
 
@@ -310,45 +336,53 @@ TupleObject *tuple_raw(Object **data, size_t len) {
 	if (len == 0) {
 		return &empty_tuple;
 	}
-	TupleObject *result = (TupleObject*)gc_alloc(sizeof(TupleObject) + sizeof(Object*) * len);
+	// without data, the tuple is filled in later and has to start out empty
+	size_t size = sizeof(TupleObject) + sizeof(Object*) * len;
+	TupleObject *result = (TupleObject*)(data != NULL ? gc_alloc_uninit(size) : gc_alloc(size));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
 	result->header.type = &g_tuple;
-	result->header.table = &tuple_table;
+	result->header.table_id = TABLE_TUPLE;
 	result->len = len;
 	if (data != NULL) {
 		memcpy(result->data, data, sizeof(Object*) * len);
+		gc_write_all((Object*)result, data, len);
 	}
 	return result;
 }
 
 TupleObject *tuple_raw_ex(Object **data, size_t len, TypeObject *type) {
 	// duplicated logic to avoid the empty_tuple singleton
-	TupleObject *result = (TupleObject*)gc_alloc(sizeof(TupleObject) + sizeof(Object*) * len);
+	// without data, the tuple is filled in later and has to start out empty
+	size_t size = sizeof(TupleObject) + sizeof(Object*) * len;
+	TupleObject *result = (TupleObject*)(data != NULL ? gc_alloc_uninit(size) : gc_alloc(size));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
 	result->header.type = type;
-	result->header.table = &tuple_table;
+	result->header.table_id = TABLE_TUPLE;
 	result->len = len;
 	if (data != NULL) {
 		memcpy(result->data, data, sizeof(Object*) * len);
+		gc_write_all((Object*)result, data, len);
 	}
 	return result;
 }
 
 BytesObject *bytes_raw(const char *data, size_t len) {
-	BytesObject *result = (BytesObject*)gc_alloc(sizeof(BytesObject) + len * sizeof(char));
+	size_t size = sizeof(BytesObject) + len * sizeof(char);
+	BytesObject *result = (BytesObject*)(data != NULL ? gc_alloc_uninit(size) : gc_alloc(size));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
 	result->header.type = &g_bytes;
-	result->header.table = &bytes_table;
+	result->header.table_id = TABLE_BYTES;
 	result->len = len;
+	result->hash = 0;
 	if (data != NULL) {
 		memcpy(result->_data, data, len * sizeof(char));
 	}
@@ -365,17 +399,19 @@ BytesObject *bytes_raw_ex(const char *data, size_t len, TypeObject *type) {
 }
 
 BytesUnownedObject *bytes_unowned_raw(const char *data, size_t len, Object *owner) {
-	BytesUnownedObject *result = (BytesUnownedObject*)gc_alloc(sizeof(BytesUnownedObject));
+	BytesUnownedObject *result = (BytesUnownedObject*)gc_alloc_uninit(sizeof(BytesUnownedObject));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
 
 	result->header_bytes.header.type = &g_bytes;
-	result->header_bytes.header.table = &bytes_unowned_table;
+	result->header_bytes.header.table_id = TABLE_BYTES_UNOWNED;
 	result->header_bytes.len = len;
+	result->header_bytes.hash = 0;
 	result->_data = data;
 	result->owner = owner;
+	GC_WRITE(result, owner);
 	return result;
 }
 
@@ -396,11 +432,11 @@ BytearrayObject *bytearray_raw(const char *data, size_t len, TypeObject *type) {
 	}
 
 	result->header_bytes.header.type = type;
-	result->header_bytes.header.table = &bytearray_table;
+	result->header_bytes.header.table_id = TABLE_BYTEARRAY;
 	result->header_bytes.len = len;
-	result->data = current_thread_alloc(len);
+	result->data = data != NULL ? current_thread_alloc_uninit(len) : current_thread_alloc(len);
 	if (result->data == NULL) {
-		current_thread_dealloc(result, sizeof(BytearrayObject));
+		result->header_bytes.len = 0;
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
@@ -418,7 +454,7 @@ DictObject *dicto_raw() {
 		return NULL;
 	}
 	result->header.type = &g_dict;
-	result->header.table = &dicto_table;
+	result->header.table_id = TABLE_DICTO;
 	return result;
 }
 
@@ -438,7 +474,8 @@ BasicObject *object_raw(TypeObject *type) {
 		return NULL;
 	}
 	result->header_dict.header.type = type;
-	result->header_dict.header.table = &object_table;
+	result->header_dict.header.table_id = TABLE_OBJECT;
+	result->shape = &shape_root;
 	return result;
 }
 
@@ -449,9 +486,11 @@ ClosureObject *closure_raw(BytesObject *bytecode, DictObject *context) {
 		return NULL;
 	}
 	result->header.type = &g_closure;
-	result->header.table = &closure_table;
+	result->header.table_id = TABLE_CLOSURE;
 	result->bytecode = bytecode;
 	result->context = context;
+	GC_WRITE(result, bytecode);
+	GC_WRITE(result, context);
 	return result;
 }
 
@@ -465,15 +504,17 @@ ClosureObject *closure_raw_ex(BytesObject *bytecode, DictObject *context, TypeOb
 }
 
 BoundMethodObject *boundmeth_raw(Object *meth, Object *self) {
-	BoundMethodObject *result = (BoundMethodObject*)gc_alloc(sizeof(BoundMethodObject));
+	BoundMethodObject *result = (BoundMethodObject*)gc_alloc_uninit(sizeof(BoundMethodObject));
 	if (!result) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
 	result->header.type = &g_boundmeth;
-	result->header.table = &boundmeth_table;
+	result->header.table_id = TABLE_BOUNDMETH;
 	result->method = meth;
 	result->self = self;
+	GC_WRITE(result, meth);
+	GC_WRITE(result, self);
 	return result;
 }
 
@@ -484,9 +525,11 @@ SliceObject *slice_raw(Object *start, Object *end) {
 		return NULL;
 	}
 	result->header.type = &g_slice;
-	result->header.table = &slice_table;
+	result->header.table_id = TABLE_SLICE;
 	result->start = start;
 	result->end = end;
+	GC_WRITE(result, start);
+	GC_WRITE(result, end);
 	return result;
 }
 
@@ -507,8 +550,9 @@ ExceptionObject *exc_raw(TypeObject *type, TupleObject *args) {
 		return NULL;
 	}
 	result->header.type = type;
-	result->header.table = &exc_table;
+	result->header.table_id = TABLE_EXC;
 	result->args = args;
+	GC_WRITE(result, args);
 	return result;
 }
 
@@ -623,7 +667,7 @@ Object *float_constructor(Object *_self, TupleObject *args) {
 }
 
 Object *object_constructor(Object *_self, TupleObject *args) {
-	if (_self->table != &type_table) {
+	if (_self->table_id != TABLE_TYPE) {
 		puts("Fatal: object constructor called with something that is not a type");
 		abort();
 	}
@@ -633,25 +677,230 @@ Object *object_constructor(Object *_self, TupleObject *args) {
 	if (result == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)result);
+	GC_TEMP_ROOT((Object*)result);
 	Object *init = get_attr_inner((Object*)result, "__init__");
 	if (init) {
 		if (!call(init, args)) {
-			gc_unroot((Object*)result);
+			GC_TEMP_UNROOT((Object*)result);
 			return NULL;
 		}
 	}
-	gc_unroot((Object*)result);
+	GC_TEMP_UNROOT((Object*)result);
 	return (Object*)result;
 }
 
+// objects which go past SHAPE_MAX_SLOTS attributes, or get one named by something other than bytes,
+// go back to keeping them in a dict. so do the ones which would add a child to a shape with
+// SHAPE_MAX_CHILDREN of them already, so names made up at runtime can't grow the tree without end
+#define SHAPE_MAX_SLOTS 64
+#define SHAPE_MAX_CHILDREN 64
+// shapes aren't charged to any group, so there can only be so many at a time. past that, objects
+// which would need a new one use a dict too
+#define SHAPE_MAX_SHAPES 4096
+
+Shape shape_root;
+size_t shape_count;     // shape_root not included
+size_t shape_epoch = 1; // bumped by each purge
+size_t shape_pins;      // lookups which may run script code while partway along a shape's parents
+
+typedef struct SlotResult {
+	size_t slot;
+	bool found;
+	bool success;
+} SlotResult;
+
+HashResult shape_hasher(void *shape) {
+	return (HashResult) {
+		.hash = ((Shape*)shape)->hash,
+		.success = true,
+	};
+}
+
+EqualityResult shape_equals(void *_shape1, void *_shape2) {
+	Shape *shape1 = (Shape*)_shape1;
+	Shape *shape2 = (Shape*)_shape2;
+	return (EqualityResult) {
+		.equals = shape1->hash == shape2->hash && shape1->name->len == shape2->name->len && memcmp(bytes_data(shape1->name), bytes_data(shape2->name), shape1->name->len) == 0,
+		.success = true,
+	};
+}
+
+// anything but bytes has to be compared the slow way, with a copy of the name that it may keep
+EqualityResult shape_equals_slow(Object *name, Shape *shape) {
+	BytesObject *copy = bytes_raw(bytes_data(shape->name), shape->name->len);
+	if (copy == NULL) {
+		return (EqualityResult) { .success = false };
+	}
+	GC_TEMP_ROOT((Object*)copy);
+	EqualityResult result = object_equals(name, (Object*)copy);
+	GC_TEMP_UNROOT((Object*)copy);
+	return result;
+}
+
+// which slot is for name. hash is only used if name is exactly bytes
+SlotResult shape_find(Shape *shape, Object *name, uint64_t hash) {
+	Shape probe = {
+		.name = (BytesObject*)name,
+		.hash = hash,
+	};
+	// script code could make the object drop its shape and then collect, so hold off the purge
+	bool slow = name->type != &g_bytes;
+	shape_pins += slow;
+	SlotResult result = {
+		.found = false,
+		.success = true,
+	};
+	for (; shape != &shape_root; shape = shape->parent) {
+		EqualityResult eq = slow ? shape_equals_slow(name, shape) : shape_equals(&probe, shape);
+		if (!eq.success) {
+			result.success = false;
+			break;
+		}
+		if (eq.equals) {
+			result.slot = shape->count - 1;
+			result.found = true;
+			break;
+		}
+	}
+	shape_pins -= slow;
+	return result;
+}
+
+// the shape after this one when name is added. NULL if the object should use a dict instead
+Shape *shape_child(Shape *shape, BytesObject *name, uint64_t hash) {
+	Shape probe = {
+		.name = name,
+		.hash = hash,
+	};
+	GetResult child = dict_get(&shape->children, &probe, shape_hasher, shape_equals);
+	if (child.found) {
+		((Shape*)child.val)->epoch = shape_epoch;
+		return (Shape*)child.val;
+	}
+	if (shape->count >= SHAPE_MAX_SLOTS || shape->children.len >= SHAPE_MAX_CHILDREN || shape_count >= SHAPE_MAX_SHAPES) {
+		return NULL;
+	}
+	Shape *result = global_alloc(sizeof(Shape));
+	BytesObject *copy = global_alloc(sizeof(BytesObject) + name->len);
+	if (result == NULL || copy == NULL) {
+		global_dealloc(result, sizeof(Shape));
+		global_dealloc(copy, sizeof(BytesObject) + name->len);
+		return NULL;
+	}
+	// the shape outlives whoever named it, so it gets a copy which the collector leaves alone
+	copy->header.type = &g_bytes;
+	copy->header.table_id = TABLE_BYTES;
+	copy->header.group_id = ROOT_GROUP_ID;
+	copy->header.gc_flags = GC_IMMORTAL | GC_MARKED;
+	copy->len = name->len;
+	copy->hash = hash;
+	memcpy(copy->_data, bytes_data(name), name->len);
+	result->parent = shape;
+	result->name = copy;
+	result->hash = hash;
+	result->count = shape->count + 1;
+	result->epoch = shape_epoch;
+	dict_construct(&result->children);
+	if (!dict_set(&shape->children, result, result, shape_hasher, NULL, global_alloc, global_dealloc)) {
+		error = NULL;
+		global_dealloc(result, sizeof(Shape));
+		global_dealloc(copy, sizeof(BytesObject) + name->len);
+		return NULL;
+	}
+	shape_count++;
+	return result;
+}
+
+// a full mark has just traced every live object, and each one marked its shape as it went. a
+// shape is still needed if that found it, if it was taken since the last purge, or if one of its
+// children is. dead objects never look at theirs
+void shape_purge() {
+	if (shape_pins != 0) {
+		return;
+	}
+	bool unused(void *key, void *val) {
+		Shape *shape = (Shape*)key;
+		dict_popwhere(&shape->children, unused, global_dealloc);
+		if (shape->epoch == shape_epoch || shape->children.len != 0) {
+			return false;
+		}
+		dict_destruct(&shape->children, global_dealloc);
+		global_dealloc(shape->name, sizeof(BytesObject) + shape->name->len);
+		global_dealloc(shape, sizeof(Shape));
+		shape_count--;
+		return true;
+	}
+	dict_popwhere(&shape_root.children, unused, global_dealloc);
+	shape_epoch++;
+}
+
+size_t slots_cap(size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+	return count <= 4 ? 4 : (size_t)1 << (64 - __builtin_clzll(count - 1));
+}
+
+// give up on the shape and move the attributes into the dict. only from the object's own group
+bool object_dictify(BasicObject *self) {
+	void *other_alloc(size_t size) { return quota_alloc(size, GROUP(self)); }
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
+	Shape *path[SHAPE_MAX_SLOTS];
+	for (Shape *shape = self->shape; shape != &shape_root; shape = shape->parent) {
+		path[shape->count - 1] = shape;
+	}
+	// the shape's names go when it does, so the dict gets names of its own
+	size_t count = self->shape->count;
+	BytesObject *names[SHAPE_MAX_SLOTS];
+	size_t named = 0;
+	bool success = true;
+	for (; named < count; named++) {
+		names[named] = bytes_raw(bytes_data(path[named]->name), path[named]->name->len);
+		if (names[named] == NULL) {
+			success = false;
+			break;
+		}
+		names[named]->hash = path[named]->hash;
+		GC_TEMP_ROOT((Object*)names[named]);
+	}
+	// the names are all different, so they need no comparing
+	DictCore core;
+	dict_construct(&core);
+	for (size_t i = 0; success && i < count; i++) {
+		if (self->slots[i] != NULL && !dict_set(&core, names[i], self->slots[i], object_hasher, NULL, other_alloc, other_dealloc)) {
+			dict_destruct(&core, other_dealloc);
+			success = false;
+		}
+	}
+	if (success) {
+		if (self->slots != NULL) {
+			quota_dealloc(self->slots, self->slots_size * sizeof(Object*), GROUP(self));
+		}
+		self->slots = NULL;
+		self->slots_size = 0;
+		self->shape = NULL;
+		self->header_dict.core = core;
+	}
+	while (named > 0) {
+		GC_TEMP_UNROOT((Object*)names[--named]);
+	}
+	return success;
+}
+
 size_t object_size(Object *_self) {
 	BasicObject *self = (BasicObject*)_self;
-	return sizeof(BasicObject) + dict_size(&self->header_dict.core);
+	return sizeof(BasicObject) + self->slots_size * sizeof(Object*) + dict_size(&self->header_dict.core);
 }
 
 bool object_trace(Object *_self, bool (*tracer)(Object *tracee)) {
 	BasicObject *self = (BasicObject*)_self;
+	if (self->shape != NULL) {
+		self->shape->epoch = shape_epoch;
+		for (size_t i = 0; i < self->shape->count; i++) {
+			if (self->slots[i] != NULL && !tracer(self->slots[i])) return false;
+		}
+		return true;
+	}
 	bool inner_tracer(void *key, void **val) {
 		if (!tracer(key)) return false;
 		if (!tracer(*val)) return false;
@@ -662,7 +911,10 @@ bool object_trace(Object *_self, bool (*tracer)(Object *tracee)) {
 
 void object_finalize(Object *_self) {
 	BasicObject *self = (BasicObject*)_self;
-	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, self->header_dict.header.group); }
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
+	if (self->slots != NULL) {
+		other_dealloc(self->slots, self->slots_size * sizeof(Object*));
+	}
 	dict_destruct(&self->header_dict.core, other_dealloc);
 }
 
@@ -687,14 +939,33 @@ EqualityResult string_equals(void *val1, void *val2) {
 	};
 }
 
+// object_get_attr without the AttributeError, for callers which have somewhere else to look
+GetResult object_lookup(BasicObject *self, Object *name) {
+	if (self->shape != NULL) {
+		Shape *shape = self->shape;
+		SlotResult slot = shape_find(shape, name, name->type == &g_bytes ? bytes_hash_raw((BytesObject*)name) : 0);
+		// comparing a name that isn't exactly bytes runs script code, which may have grown the object a new
+		// shape or turned it into a dict. shapes only grow or go away, so trying again terminates
+		if (slot.success && self->shape != shape) {
+			return object_lookup(self, name);
+		}
+		return (GetResult) {
+			.val = slot.found ? self->slots[slot.slot] : NULL,
+			.found = slot.found && self->slots[slot.slot] != NULL,
+			.success = slot.success,
+		};
+	}
+	return dict_get(&self->header_dict.core, (void*)name, object_hasher, object_equals);
+}
+
 Object *object_get_attr(Object *_self, Object *name) {
 	BasicObject *self = (BasicObject*)_self;
-	GetResult result = dict_get(&self->header_dict.core, (void*)name, object_hasher, object_equals);
+	GetResult result = object_lookup(self, name);
 	if (!result.success) {
 		return NULL;
 	}
 	if (!result.found) {
-		error = exc_arg(&g_AttributeError, name);
+		error = exc_lazy_arg(&g_AttributeError, name);
 		return NULL;
 	}
 	return (Object*)result.val;
@@ -702,24 +973,93 @@ Object *object_get_attr(Object *_self, Object *name) {
 
 bool object_set_attr(Object *_self, Object *name, Object *val) {
 	BasicObject *self = (BasicObject*)_self;
-	if (CURRENT_GROUP != self->header_dict.header.group && !dict_get(&self->header_dict.core, (void*)name, object_hasher, object_equals).found) {
+	if (self->shape != NULL) {
+		Shape *shape = self->shape;
+		uint64_t hash = name->type == &g_bytes ? bytes_hash_raw((BytesObject*)name) : 0;
+		SlotResult slot = shape_find(shape, name, hash);
+		if (!slot.success) {
+			return false;
+		}
+		// as in object_lookup
+		if (self->shape != shape) {
+			return object_set_attr(_self, name, val);
+		}
+		if (slot.found && self->slots[slot.slot] != NULL) {
+			self->slots[slot.slot] = val;
+			GC_WRITE(self, val);
+			return true;
+		}
+		if (CURRENT_GROUP != GROUP(self)) {
+			error = exc_msg(&g_RuntimeError, "Cannot allocate space in another group");
+			return false;
+		}
+		if (slot.found) {
+			self->slots[slot.slot] = val;
+			GC_WRITE(self, val);
+			return true;
+		}
+		Shape *child = name->type == &g_bytes ? shape_child(self->shape, (BytesObject*)name, hash) : NULL;
+		if (child != NULL) {
+			size_t new_cap = slots_cap(child->count);
+			if (new_cap != self->slots_size) {
+				Object **slots = quota_realloc(self->slots, new_cap * sizeof(Object*), self->slots_size * sizeof(Object*), GROUP(self));
+				if (slots == NULL) {
+					error = (Object*)&MemoryError_inst;
+					return false;
+				}
+				self->slots = slots;
+				self->slots_size = new_cap;
+			}
+			self->slots[child->count - 1] = val;
+			self->shape = child;
+			GC_WRITE(self, val);
+			return true;
+		}
+		if (!object_dictify(self)) {
+			return false;
+		}
+	}
+	if (CURRENT_GROUP != GROUP(self) && !dict_get(&self->header_dict.core, (void*)name, object_hasher, object_equals).found) {
 		error = exc_msg(&g_RuntimeError, "Cannot allocate space in another group");
 		return NULL;
 	}
-	void *other_alloc(size_t size) { return quota_alloc(size, self->header_dict.header.group); }
-	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, self->header_dict.header.group); }
-	return dict_set(&self->header_dict.core, (void*)name, (void*)val, object_hasher, object_equals, other_alloc, other_dealloc);
+	void *other_alloc(size_t size) { return quota_alloc(size, GROUP(self)); }
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
+	if (!dict_set(&self->header_dict.core, (void*)name, (void*)val, object_hasher, object_equals, other_alloc, other_dealloc)) {
+		return false;
+	}
+	GC_WRITE(self, name);
+	GC_WRITE(self, val);
+	return true;
 }
 
 bool object_del_attr(Object *_self, Object *name) {
 	BasicObject *self = (BasicObject*)_self;
-	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, self->header_dict.header.group); }
+	if (self->shape != NULL) {
+		Shape *shape = self->shape;
+		SlotResult slot = shape_find(shape, name, name->type == &g_bytes ? bytes_hash_raw((BytesObject*)name) : 0);
+		if (!slot.success) {
+			return false;
+		}
+		// as in object_lookup
+		if (self->shape != shape) {
+			return object_del_attr(_self, name);
+		}
+		if (!slot.found || self->slots[slot.slot] == NULL) {
+			error = exc_lazy_arg(&g_AttributeError, name);
+			return false;
+		}
+		// the shape stays, so putting it back doesn't have to find another one
+		self->slots[slot.slot] = NULL;
+		return true;
+	}
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
 	GetResult result = dict_pop(&self->header_dict.core, (void*)name, object_hasher, object_equals, other_dealloc);
 	if (!result.success) {
 		return false;
 	}
 	if (!result.found) {
-		error = exc_arg(&g_AttributeError, name);
+		error = exc_lazy_arg(&g_AttributeError, name);
 		return false;
 	}
 	return true;
@@ -750,7 +1090,7 @@ bool dicto_trace(Object *_self, bool (*tracer)(Object *tracee)) {
 
 void dicto_finalize(Object *_self) {
 	DictObject *self = (DictObject*)_self;
-	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, self->header.group); }
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
 	dict_destruct(&self->core, other_dealloc);
 }
 
@@ -760,7 +1100,7 @@ Object *dicto_get_attr(Object *_self, Object *name) {
 		return (Object*)int_raw(self->core.len);
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -792,7 +1132,8 @@ size_t tuple_size(Object *_self) {
 bool tuple_trace(Object *_self, bool (*tracer)(Object *tracee)) {
 	TupleObject *self = (TupleObject*)_self;
 	for (size_t i = 0; i < self->len; i++) {
-		if (!tracer(self->data[i])) {
+		// a tuple made with tuple_raw(NULL, n) is filled in one call at a time, and can be found half-done
+		if (self->data[i] != NULL && !tracer(self->data[i])) {
 			return false;
 		}
 	}
@@ -805,10 +1146,39 @@ Object *tuple_get_attr(Object *_self, Object *name) {
 		return (Object*)int_raw(self->len);
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
+HashResult tuple_hash_raw(TupleObject *self) {
+	uint64_t hash = 0x0123456789abcdef;
+	for (size_t i = 0; i < self->len; i++) {
+		HashResult hashed = object_hasher(self->data[i]);
+		if (!hashed.success) {
+			return hashed;
+		}
+		hash += hashed.hash;
+		hash = (hash << 17) | (hash >> (64-17));
+	}
+	return (HashResult) {
+		.hash = hash,
+		.success = true,
+	};
+}
+
+EqualityResult tuple_equals_raw(TupleObject *self, TupleObject *other) {
+	for (size_t i = 0; i < self->len && i < other->len; i++) {
+		EqualityResult eq = object_equals(self->data[i], other->data[i]);
+		if (!eq.success || !eq.equals) {
+			return eq;
+		}
+	}
+	return (EqualityResult) {
+		.equals = true,
+		.success = true,
+	};
+}
+
 Object *list_constructor(Object *_self, TupleObject *args) {
 	TypeObject *self = (TypeObject*)_self;
 	if (args->len == 0) {
@@ -846,7 +1216,7 @@ bool list_trace(Object *_self, bool (*tracer)(Object *tracee)) {
 
 void list_finalize(Object *_self) {
 	ListObject *self = (ListObject*)_self;
-	quota_dealloc(self->data, sizeof(Object*) * self->cap, self->header.group);
+	quota_dealloc(self->data, sizeof(Object*) * self->cap, GROUP(self));
 	self->data = NULL;
 	self->len = 0;
 	self->cap = 0;
@@ -858,7 +1228,7 @@ Object *list_get_attr(Object *_self, Object *name) {
 		return (Object*)int_raw(self->len);
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -886,11 +1256,15 @@ Object *type_constructor(Object *self, TupleObject *args) {
 		}
 		DictObject *arg2 = (DictObject*)_arg2;
 		TypeObject *result = (TypeObject*)gc_alloc(sizeof(TypeObject));
-		result->header_basic.header_dict.header.table = &type_table;
+		result->header_basic.header_dict.header.table_id = TABLE_TYPE;
 		result->header_basic.header_dict.header.type = (TypeObject*)self;
 		result->base_class = (TypeObject*)_arg1,
 		result->constructor = result->base_class->constructor;
+		type_display_init(result);
+		GC_WRITE(result, result->base_class);
 		bool inner_tracer(void *key, void **val) {
+			GC_WRITE(result, key);
+			GC_WRITE(result, *val);
 			return dict_set(&result->header_basic.header_dict.core, key, *val, object_hasher, object_equals, current_thread_alloc, current_thread_dealloc);
 		}
 		dict_trace(&arg2->core, inner_tracer);
@@ -901,6 +1275,21 @@ Object *type_constructor(Object *self, TupleObject *args) {
 	}
 }
 
+void type_display_init(TypeObject *type) {
+	size_t depth = 0;
+	if (type->base_class != NULL) {
+		if (type->base_class->display_len == 0) {
+			type_display_init(type->base_class);
+		}
+		depth = type->base_class->display_len;
+		memcpy(type->display, type->base_class->display, sizeof(TypeObject*) * (depth < TYPE_DISPLAY_MAX ? depth : TYPE_DISPLAY_MAX));
+	}
+	if (depth < TYPE_DISPLAY_MAX) {
+		type->display[depth] = type;
+	}
+	type->display_len = depth + 1;
+}
+
 size_t type_size(Object *_self) {
 	TypeObject *self = (TypeObject*)_self;
 	return sizeof(TypeObject) + dict_size(&self->header_basic.header_dict.core);
@@ -915,17 +1304,95 @@ bool type_trace(Object *_self, bool (*tracer)(Object *tracee)) {
 	return true;
 }
 
-Object *type_get_attr(Object *self, Object *name) {
+// the type's own attribute, without the AttributeError
+GetResult type_lookup_own(TypeObject *self, Object *name) {
 	// some hacks :)
-	if (self == (Object*)&g_bytes && name->type == &g_bytes) {
+	if (self == &g_bytes && name->type == &g_bytes) {
 		if (strncmp(bytes_data((BytesObject*)name), "__hash__", strlen("__hash__")) == 0) {
-			return (Object*)&g_bytes___hash__;
+			return (GetResult) { .val = &g_bytes___hash__, .found = true, .success = true };
 		}
 		if (strncmp(bytes_data((BytesObject*)name), "__eq__", strlen("__eq__")) == 0) {
-			return (Object*)&g_bytes___eq__;
+			return (GetResult) { .val = &g_bytes___eq__, .found = true, .success = true };
 		}
 	}
-	return object_get_attr(self, name);
+	return object_lookup(&self->header_basic, name);
+}
+
+Object *type_get_attr(Object *self, Object *name) {
+	GetResult result = type_lookup_own((TypeObject*)self, name);
+	if (!result.success) {
+		return NULL;
+	}
+	if (!result.found) {
+		error = exc_lazy_arg(&g_AttributeError, name);
+		return NULL;
+	}
+	return (Object*)result.val;
+}
+
+// what looking name up through type and its bases finds, by (type, name). nothing in here is kept
+// alive by it, so every collection throws it all out by bumping the epoch. types can't be changed
+// once they're made, so checking the generation of the type's own dict is only for the static ones,
+// which are filled in after the lookups that hashing their names does
+#define TYPE_CACHE_BITS 12
+typedef struct TypeCacheEntry {
+	TypeObject *type;
+	BytesObject *name;
+	uint64_t hash;      // of name's bytes
+	size_t generation;  // of type's dict
+	size_t epoch;
+	Object *val;        // NULL if none of them have it
+} TypeCacheEntry;
+TypeCacheEntry type_cache[1 << TYPE_CACHE_BITS];
+size_t type_cache_epoch = 1;
+
+void type_cache_invalidate() {
+	type_cache_epoch++;
+}
+
+// the attribute from the first of type and its bases which has it. found is false if none do.
+// names which aren't exactly bytes aren't cached
+GetResult type_lookup(TypeObject *type, Object *name) {
+	// a type whose lookup fails is passed over, and so the answer isn't kept
+	bool failed = false;
+	GetResult walk() {
+		for (TypeObject *iter = type; iter; iter = iter->base_class) {
+			GetResult result = type_lookup_own(iter, name);
+			if (!result.success) {
+				error = NULL;
+				failed = true;
+				continue;
+			}
+			if (result.found) {
+				return result;
+			}
+		}
+		return (GetResult) { .found = false, .success = true };
+	}
+	if (name->type != &g_bytes) {
+		return walk();
+	}
+	BytesObject *bytes = (BytesObject*)name;
+	uint64_t hash = bytes_hash_raw(bytes);
+	size_t generation = type->header_basic.header_dict.core.generation;
+	TypeCacheEntry *entry = &type_cache[(hash ^ (uintptr_t)type) * 0x9e3779b97f4a7c15ull >> (64 - TYPE_CACHE_BITS)];
+	if (entry->epoch == type_cache_epoch && entry->type == type && entry->generation == generation && entry->hash == hash &&
+			entry->name->len == bytes->len && memcmp(bytes_data(entry->name), bytes_data(bytes), bytes->len) == 0) {
+		return (GetResult) { .val = entry->val, .found = entry->val != NULL, .success = true };
+	}
+	GetResult result = walk();
+	if (!failed) {
+		// looking it up may have run a collection, and the entry is only good from here on
+		*entry = (TypeCacheEntry) {
+			.type = type,
+			.name = bytes,
+			.hash = hash,
+			.generation = type->header_basic.header_dict.core.generation,
+			.epoch = type_cache_epoch,
+			.val = result.found ? result.val : NULL,
+		};
+	}
+	return result;
 }
 
 Object *type_call(Object *_self, TupleObject *args) {
@@ -964,7 +1431,7 @@ Object *closure_get_attr(Object *_self, Object *name) {
 		return (Object*)self->bytecode;
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -995,9 +1462,9 @@ Object *bytes_constructor(Object *_self, TupleObject *args) {
 		return NULL;
 	}
 	TupleObject *new_args = tuple_raw(NULL, 0);
-	gc_root((Object*)new_args);
+	GC_TEMP_ROOT((Object*)new_args);
 	Object *result = call(method, new_args);
-	gc_unroot((Object*)new_args);
+	GC_TEMP_UNROOT((Object*)new_args);
 	if (result == NULL) {
 		return NULL;
 	}
@@ -1017,9 +1484,9 @@ BytesObject *bytes_constructor_inner(Object *arg) {
 	if (args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)args);
+	GC_TEMP_ROOT((Object*)args);
 	Object *result = bytes_constructor((Object*)&g_bytes, args);
-	gc_unroot((Object*)args);
+	GC_TEMP_UNROOT((Object*)args);
 	return (BytesObject*)result;
 }
 
@@ -1029,22 +1496,70 @@ size_t bytes_size(Object *_self) {
 }
 
 const char *bytes_data(BytesObject *self) {
-	if (self->header.table == &bytes_unowned_table) {
+	if (self->header.table_id == TABLE_BYTES_UNOWNED) {
 		return ((BytesUnownedObject*)self)->_data;
-	} else if (self->header.table == &bytearray_table) {
+	} else if (self->header.table_id == TABLE_BYTEARRAY) {
 		return ((BytearrayObject*)self)->data;
 	} else {
 		return self->_data;
 	}
 }
 
+uint64_t hash_mix(uint64_t a, uint64_t b) {
+	__uint128_t product = (__uint128_t)a * b;
+	return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+uint64_t hash_read(const unsigned char *data, size_t len) {
+	uint64_t result = 0;
+	memcpy(&result, data, len);
+	return result;
+}
+
+// after wyhash: sixteen bytes per multiply, folded 128 bits down to 64
+// https://github.com/wangyi-fudan/wyhash
+uint64_t hash_data(const char *_data, size_t len) {
+	const unsigned char *data = (const unsigned char*)_data;
+	uint64_t seed = 0xa0761d6478bd642full ^ len;
+	size_t i = 0;
+	for (; i + 16 <= len; i += 16) {
+		seed = hash_mix(hash_read(data + i, 8) ^ 0xe7037ed1a0b428dbull, hash_read(data + i + 8, 8) ^ seed);
+	}
+	size_t rest = len - i;
+	uint64_t a = hash_read(data + i, rest < 8 ? rest : 8);
+	uint64_t b = rest > 8 ? hash_read(data + i + 8, rest - 8) : 0;
+	return hash_mix(0x8ebc6af09c88c6e3ull ^ len, hash_mix(a ^ 0xe7037ed1a0b428dbull, b ^ seed));
+}
+
+uint64_t bytes_hash_raw(BytesObject *self) {
+	if (self->header.table_id == TABLE_BYTEARRAY) {
+		return hash_data(bytes_data(self), self->len);
+	}
+	// a string which happens to hash to 0 is just hashed every time
+	if (self->hash == 0) {
+		self->hash = hash_data(bytes_data(self), self->len);
+	}
+	return self->hash;
+}
+
+bool bytes_equals_raw(BytesObject *self, BytesObject *other) {
+	if (self->len != other->len) {
+		return false;
+	}
+	// both hashes being known and different settles it without looking at the bytes
+	if (self->hash != 0 && other->hash != 0 && self->hash != other->hash) {
+		return false;
+	}
+	return memcmp(bytes_data(self), bytes_data(other), self->len) == 0;
+}
+
 Object *bytes_get_attr(Object *_self, Object *name) {
 	BytesObject *self = (BytesObject*)_self;
 	if (object_equals_str(name, "len")) {
 		return (Object*)int_raw(self->len);
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -1071,7 +1586,7 @@ Object *bytearray_constructor(Object *self, TupleObject *args) {
 
 void bytearray_finalize(Object *_self) {
 	BytearrayObject *self = (BytearrayObject*)_self;
-	quota_dealloc(self->data, self->cap, self->header_bytes.header.group);
+	quota_dealloc(self->data, self->cap, GROUP(self));
 	self->data = NULL;
 	self->header_bytes.len = 0;
 	self->cap = 0;
@@ -1095,9 +1610,9 @@ Object *bool_constructor(Object *self, TupleObject *args) {
 		return NULL;
 	}
 	TupleObject *new_args = tuple_raw(NULL, 0);
-	gc_root((Object*)new_args);
+	GC_TEMP_ROOT((Object*)new_args);
 	Object *result = call(method, new_args);
-	gc_unroot((Object*)new_args);
+	GC_TEMP_UNROOT((Object*)new_args);
 	if (result == NULL) {
 		return NULL;
 	}
@@ -1113,9 +1628,9 @@ EmptyObject *bool_constructor_inner(Object *obj) {
 	if (inner_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)inner_args);
+	GC_TEMP_ROOT((Object*)inner_args);
 	Object *result = bool_constructor((Object*)&g_bool, inner_args);
-	gc_unroot((Object*)inner_args);
+	GC_TEMP_UNROOT((Object*)inner_args);
 	return (EmptyObject*)result;
 }
 
@@ -1130,15 +1645,17 @@ Object *dict_constructor(Object *_self, TupleObject *args) {
 		}
 		DictObject *input = (DictObject*)args->data[0];
 		DictObject *result = dicto_raw_ex(self);
-		gc_root((Object*)result);
+		GC_TEMP_ROOT((Object*)result);
 		bool inner_tracer(void *key, void **val) {
+			GC_WRITE(result, key);
+			GC_WRITE(result, *val);
 			return dict_set(&result->core, key, *val, object_hasher, object_equals, current_thread_alloc, current_thread_dealloc);
 		}
 		if (!dict_trace(&input->core, inner_tracer)) {
-			gc_unroot((Object*)result);
+			GC_TEMP_UNROOT((Object*)result);
 			return NULL;
 		}
-		gc_unroot((Object*)result);
+		GC_TEMP_UNROOT((Object*)result);
 		return (Object*)result;
 	}
 	error = exc_msg(&g_TypeError, "Expected 0 or 1 arguments");
@@ -1147,9 +1664,9 @@ Object *dict_constructor(Object *_self, TupleObject *args) {
 
 DictObject *dict_dup_inner(DictObject *self) {
 	TupleObject *args = tuple_raw((Object**)&self, 1);
-	gc_root((Object*)args);
+	GC_TEMP_ROOT((Object*)args);
 	Object *result = dict_constructor((Object*)&g_dict, args);
-	gc_unroot((Object*)args);
+	GC_TEMP_UNROOT((Object*)args);
 	return (DictObject*)result;
 }
 
@@ -1182,7 +1699,7 @@ Object *boundmeth_get_attr(Object *_self, Object *name) {
 		return (Object*)self->self;
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -1195,9 +1712,9 @@ Object *boundmeth_call(Object *_self, TupleObject *args) {
 	if (new_args == NULL) {
 		return NULL;
 	}
-	gc_root((Object*)new_args);
+	GC_TEMP_ROOT((Object*)new_args);
 	Object *result = call(self->method, new_args);
-	gc_unroot((Object*)new_args);
+	GC_TEMP_UNROOT((Object*)new_args);
 	return result;
 }
 
@@ -1216,7 +1733,7 @@ Object *bytes_unowned_get_attr(Object *_self, Object *name) {
 		return (Object*)int_raw(self->header_bytes.len);
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -1244,7 +1761,7 @@ Object *slice_get_attr(Object *_self, Object *name) {
 		return self->end;
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -1264,7 +1781,7 @@ Object *exc_get_attr(Object *_self, Object *name) {
 		return (Object*)self->args;
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -1273,9 +1790,9 @@ Object *get_attr_inner(Object *self, char *name) {
 	if (!temp) {
 		return NULL;
 	}
-	gc_root(temp);
+	GC_TEMP_ROOT(temp);
 	Object *result = get_attr(self, temp);
-	gc_unroot(temp);
+	GC_TEMP_UNROOT(temp);
 	return result;
 }
 Object *get_attr(Object *self, Object *name) {
@@ -1288,37 +1805,39 @@ Object *get_attr(Object *self, Object *name) {
 	}
 
 	if (check_own) {
-		result = self->table->get_attr(self, name);
-		if (result != NULL) {
-			return result;
-		}
-		error = NULL;
-
+		// the usual cases can miss without making an AttributeError only to throw it out
+		if (self->table_id == TABLE_OBJECT) {
+			GetResult own = object_lookup((BasicObject*)self, name);
+			if (own.found) {
+				return (Object*)own.val;
+			}
+			error = NULL;
 		// is this right?
-		if (self->table == &type_table) {
-			for (TypeObject *type = ((TypeObject*)self)->base_class; type; type = type->base_class) {
-				result = type->header_basic.header_dict.header.table->get_attr((Object*)type, name);
-				if (result != NULL) {
-					return result;
-				}
-				error = NULL;
+		} else if (self->table_id == TABLE_TYPE) {
+			GetResult own = type_lookup((TypeObject*)self, name);
+			if (own.found) {
+				return (Object*)own.val;
 			}
-		}
-	}
-	
-	for (TypeObject *type = self->type; type; type = type->base_class) {
-		result = type->header_basic.header_dict.header.table->get_attr((Object*)type, name);
-		if (result != NULL) {
-			// maybe could be an interesting source of bugs if we let any object be bound and do property forwards through boundmeth
-			if (isinstance_inner(result, &g_builtin) || isinstance_inner(result, &g_closure)) {
-				result = (Object*)boundmeth_raw(result, self);
+			error = NULL;
+		} else {
+			result = TABLE(self)->get_attr(self, name);
+			if (result != NULL) {
+				return result;
 			}
-			return result;
+			error = NULL;
 		}
-		error = NULL;
 	}
 
-	error = exc_arg(&g_AttributeError, name);
+	GetResult found = type_lookup(self->type, name);
+	if (found.found) {
+		result = (Object*)found.val;
+		// maybe could be an interesting source of bugs if we let any object be bound and do property forwards through boundmeth
+		if (isinstance_inner(result, &g_builtin) || isinstance_inner(result, &g_closure)) {
+			result = (Object*)boundmeth_raw(result, self);
+		}
+		return result;
+	}
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 bool set_attr_inner(Object *self, char *name, Object *value) {
@@ -1326,13 +1845,13 @@ bool set_attr_inner(Object *self, char *name, Object *value) {
 	if (!temp) {
 		return NULL;
 	}
-	gc_root(temp);
+	GC_TEMP_ROOT(temp);
 	bool result = set_attr(self, temp, value);
-	gc_unroot(temp);
+	GC_TEMP_UNROOT(temp);
 	return result;
 }
 bool set_attr(Object *self, Object *name, Object *value) {
-	return self->table->set_attr(self, name, value);
+	return TABLE(self)->set_attr(self, name, value);
 }
 
 bool del_attr_inner(Object *self, char *name) {
@@ -1340,38 +1859,58 @@ bool del_attr_inner(Object *self, char *name) {
 	if (!temp) {
 		return NULL;
 	}
-	gc_root(temp);
+	GC_TEMP_ROOT(temp);
 	bool result = del_attr(self, temp);
-	gc_unroot(temp);
+	GC_TEMP_UNROOT(temp);
 	return result;
 }
 bool del_attr(Object *self, Object *name) {
-	return self->table->del_attr(self, name);
+	return TABLE(self)->del_attr(self, name);
 }
 
 Object *call(Object *method, TupleObject *args) {
-	return method->table->call(method, args);
+	return TABLE(method)->call(method, args);
 }
 
 bool trace(Object *self, bool (*tracer)(Object *tracee)) {
 	if (!tracer((Object*)self->type)) return false;
-	if (self->group != NULL) {
-		// static objects have no threadgroup since they do not count toward any quota
-		if (!tracer((Object*)self->group)) return false;
-	}
-	return self->table->trace(self, tracer);
+	if (!tracer((Object*)GROUP(self))) return false;
+	return TABLE(self)->trace(self, tracer);
 }
 
 size_t size(Object *self) {
-	if (self->table->size.given < 0x1000) {
-		return self->table->size.given;
+	if (TABLE(self)->size.given < 0x1000) {
+		return TABLE(self)->size.given;
 	} else {
-		return self->table->size.computed(self);
+		return TABLE(self)->size.computed(self);
 	}
 }
 
 HashResult object_hasher(void *val) {
 	Object *self = (Object*)val;
+	// the builtin types' own __hash__ can't be replaced, so for exactly those types it's done here
+	// without looking it up and calling it. anything else, subclasses included, goes through the call
+	if (self->type == &g_int) {
+		return (HashResult) {
+			.hash = ((IntObject*)self)->value,
+			.success = true,
+		};
+	}
+	if (self->type == &g_bool) {
+		return (HashResult) {
+			.hash = self == (Object*)&g_true,
+			.success = true,
+		};
+	}
+	if (self->type == &g_bytes) {
+		return (HashResult) {
+			.hash = bytes_hash_raw((BytesObject*)self),
+			.success = true,
+		};
+	}
+	if (self->type == &g_tuple) {
+		return tuple_hash_raw((TupleObject*)self);
+	}
 	Object *method = get_attr_inner(self, "__hash__");
 	if (!method) {
 		return (HashResult) {
@@ -1380,9 +1919,15 @@ HashResult object_hasher(void *val) {
 		};
 	}
 	TupleObject *args = tuple_raw(NULL, 0);
-	gc_root((Object*)args);
+	if (args == NULL) {
+		return (HashResult) {
+			.hash = 0,
+			.success = false,
+		};
+	}
+	GC_TEMP_ROOT((Object*)args);
 	Object *result = call(method, args);
-	gc_unroot((Object*)args);
+	GC_TEMP_UNROOT((Object*)args);
 	if (result == NULL) {
 		return (HashResult) {
 			.hash = 0,
@@ -1405,6 +1950,34 @@ HashResult object_hasher(void *val) {
 EqualityResult object_equals(void *_val1, void *_val2) {
 	Object *val1 = (Object*)_val1;
 	Object *val2 = (Object*)_val2;
+	// likewise, as int_eq, bool's object_eq, bytes_eq and tuple_eq would answer
+	if (val1->type == &g_int) {
+		return (EqualityResult) {
+			.equals = isinstance_inner(val2, &g_int) && ((IntObject*)val1)->value == ((IntObject*)val2)->value,
+			.success = true,
+		};
+	}
+	if (val1->type == &g_bool) {
+		return (EqualityResult) {
+			.equals = val1 == val2,
+			.success = true,
+		};
+	}
+	if (val1->type == &g_bytes) {
+		return (EqualityResult) {
+			.equals = (isinstance_inner(val2, &g_bytes) || isinstance_inner(val2, &g_bytearray)) && bytes_equals_raw((BytesObject*)val1, (BytesObject*)val2),
+			.success = true,
+		};
+	}
+	if (val1->type == &g_tuple) {
+		if (!isinstance_inner(val2, &g_tuple)) {
+			return (EqualityResult) {
+				.equals = false,
+				.success = true,
+			};
+		}
+		return tuple_equals_raw((TupleObject*)val1, (TupleObject*)val2);
+	}
 	Object *method = get_attr_inner(val1, "__eq__");
 	if (!method) {
 		return (EqualityResult) {
@@ -1413,9 +1986,15 @@ EqualityResult object_equals(void *_val1, void *_val2) {
 		};
 	}
 	TupleObject *args = tuple_raw(&val2, 1);
-	gc_root((Object*)args);
+	if (args == NULL) {
+		return (EqualityResult) {
+			.equals = false,
+			.success = false,
+		};
+	}
+	GC_TEMP_ROOT((Object*)args);
 	Object *result = call(method, args);
-	gc_unroot((Object*)args);
+	GC_TEMP_UNROOT((Object*)args);
 	if (result == NULL) {
 		return (EqualityResult) {
 			.equals = false,
@@ -1444,4 +2023,6 @@ __attribute__((constructor)) void init_static_adds() {
 			exit(1);
 		}
 	}
+	// whatever was looked up on the way was looked up in half-filled types
+	type_cache_invalidate();
 }
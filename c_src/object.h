@@ -22,12 +22,51 @@ typedef struct ObjectTable {
 	union { size_t given; size_t (*computed)(Object*); } size;
 } ObjectTable;
 
+// tables are stored in the header as an index into object_tables
+typedef enum TableId {
+	TABLE_UNSET = 0, // the object hasn't been filled in yet
+	TABLE_NULL,
+	TABLE_DICTO,
+	TABLE_OBJECT,
+	TABLE_TYPE,
+	TABLE_INT,
+	TABLE_FLOAT,
+	TABLE_LIST,
+	TABLE_TUPLE,
+	TABLE_BYTES,
+	TABLE_BYTES_UNOWNED,
+	TABLE_BYTEARRAY,
+	TABLE_BUILTINFUNCTION,
+	TABLE_CLOSURE,
+	TABLE_BOUNDMETH,
+	TABLE_SLICE,
+	TABLE_EXC,
+	TABLE_LIST_ITERATOR,
+	TABLE_THREAD,
+	TABLE_THREADGROUP,
+	TABLE_WEAKREF,
+	TABLE_WEAKDICT,
+	TABLE_COUNT,
+} TableId;
+
+// bits in ObjectHeader.gc_flags
+#define GC_MARKED 1
+#define GC_IMMORTAL 2 // static objects. never swept, never unmarked
+#define GC_REMEMBERED 4 // in the remembered set, for holding references into other groups
+
 typedef struct ObjectHeader {
-	ObjectTable *table;
 	TypeObject *type;
-	ThreadGroupObject *group;
+	uint32_t group_id; // index into thread_groups
+	uint16_t table_id;
+	uint8_t gc_flags;
 } ObjectHeader;
 
+#define ROOT_GROUP_ID 0
+extern ObjectTable *object_tables[TABLE_COUNT];
+extern ThreadGroupObject **thread_groups;
+#define TABLE(obj) (object_tables[((Object*)(obj))->table_id])
+#define GROUP(obj) (thread_groups[((Object*)(obj))->group_id])
+
 typedef struct EmptyObject {
 	ObjectHeader header;
 } EmptyObject;
@@ -47,8 +86,27 @@ void dicto_finalize(Object *self);
 Object *dicto_get_attr(Object *self, Object *name);
 size_t dicto_size(Object *self);
 
+// instances of a class mostly get the same attributes in the same order, so they share a shape
+// which says what slot each one is in. a shape is its parent plus one more name, and the shapes
+// form a tree from shape_root. they're shared by every group, and freed by full collections once
+// nothing uses them
+typedef struct Shape {
+	struct Shape *parent;
+	BytesObject *name; // an immortal copy of the name of the last slot
+	uint64_t hash;     // of name's bytes
+	size_t count;      // slots, the last one included
+	size_t epoch;      // of the last purge which found it in use, or the current one
+	DictCore children; // Shape* -> Shape*, by name
+} Shape;
+extern Shape shape_root;
+// free the shapes which nothing has used since the last call. only right after a full mark
+void shape_purge();
+
 typedef struct BasicObject {
-	DictObject header_dict;
+	DictObject header_dict; // the attributes, if shape is NULL
+	Shape *shape;
+	Object **slots;         // NULL for an attribute which was deleted
+	size_t slots_size;      // how many slots there's room for. a dead object's shape may be gone
 } BasicObject;
 bool object_trace(Object *self, bool (*tracer)(Object *tracee));
 void object_finalize(Object *self);
@@ -58,15 +116,26 @@ bool object_del_attr(Object *self, Object *name);
 Object *object_call(Object *self, TupleObject *args);
 size_t object_size(Object *self);
 
+// types deeper than this are checked by walking the rest of the way
+#define TYPE_DISPLAY_MAX 8
 typedef struct TypeObject {
 	BasicObject header_basic;
 	TypeObject *base_class;
 	Object *(*constructor)(Object *self, TupleObject *args);
+	// the type's ancestors by depth, from the root down to itself, so checking for a subtype is a
+	// bounds check and a load. filled in when the type is made, or when a static one is first checked
+	size_t display_len; // the type's depth plus one. 0 until it's filled in
+	TypeObject *display[TYPE_DISPLAY_MAX];
 } TypeObject;
+void type_display_init(TypeObject *type);
 bool type_trace(Object *self, bool (*tracer)(Object *tracee));
 Object *type_get_attr(Object *self, Object *name);
 Object *type_call(Object *self, TupleObject *args);
 size_t type_size(Object *self);
+// the attribute from the first of type and its bases which has it, through a cache
+GetResult type_lookup(TypeObject *type, Object *name);
+// call when objects may have died, so nothing stale is found
+void type_cache_invalidate();
 
 typedef struct IntObject {
 	ObjectHeader header;
@@ -103,10 +172,13 @@ typedef struct TupleObject {
 bool tuple_trace(Object *self, bool (*tracer)(Object *tracee));
 Object *tuple_get_attr(Object *self, Object *name);
 size_t tuple_size(Object *self);
+HashResult tuple_hash_raw(TupleObject *self);
+EqualityResult tuple_equals_raw(TupleObject *self, TupleObject *other);
 
 typedef struct BytesObject {
 	ObjectHeader header;
 	size_t len;
+	uint64_t hash; // of the contents, kept from the first time it's asked for. 0 until then
 	char _data[0];
 } BytesObject;
 Object *bytes_get_attr(Object *self, Object *name);
@@ -120,6 +192,9 @@ typedef struct BytesUnownedObject {
 bool bytes_unowned_trace(Object *self, bool (*tracer)(Object *tracee));
 Object *bytes_unowned_get_attr(Object *self, Object *name);
 const char *bytes_data(BytesObject *self);
+// never cached for bytearrays, which can change
+uint64_t bytes_hash_raw(BytesObject *self);
+bool bytes_equals_raw(BytesObject *self, BytesObject *other);
 
 typedef struct BytearrayObject {
 	BytesObject header_bytes;
@@ -195,13 +270,27 @@ extern EmptyObject g_false;
 
 extern TupleObject empty_tuple;
 
-extern ObjectTable builtinfunction_table;
+extern ObjectTable null_table;
 extern ObjectTable dicto_table;
-extern ObjectTable bytes_unowned_table;
-extern ObjectTable exc_table;
+extern ObjectTable object_table;
 extern ObjectTable type_table;
 extern ObjectTable int_table;
-extern ObjectTable object_table;
+extern ObjectTable float_table;
+extern ObjectTable list_table;
+extern ObjectTable tuple_table;
+extern ObjectTable bytes_table;
+extern ObjectTable bytes_unowned_table;
+extern ObjectTable bytearray_table;
+extern ObjectTable builtinfunction_table;
+extern ObjectTable closure_table;
+extern ObjectTable boundmeth_table;
+extern ObjectTable slice_table;
+extern ObjectTable exc_table;
+extern ObjectTable list_iterator_table;
+extern ObjectTable thread_table;
+extern ObjectTable threadgroup_table;
+extern ObjectTable weakref_table;
+extern ObjectTable weakdict_table;
 
 IntObject *int_raw(int64_t value);
 IntObject *int_raw_ex(int64_t value, TypeObject *type);
@@ -247,7 +336,7 @@ typedef struct MemberInitEntry {
 #define INTERNED_STRING(var_name, s_val) \
 BytesUnownedObject var_name = { \
 	.header_bytes.header = { \
-		.table = &bytes_unowned_table, \
+		.table_id = TABLE_BYTES_UNOWNED, \
 		.type = &g_bytes, \
 	}, \
 	.header_bytes.len = sizeof(s_val) - 1, \
@@ -267,7 +356,7 @@ static MemberInitEntry static_add_##cls##_##s_value __attribute((used, section("
 Object *(cons_func)(Object *self, TupleObject *args); \
 TypeObject g_##s_name = { \
 	.header_basic.header_dict.header = { \
-		.table = &type_table, \
+		.table_id = TABLE_TYPE, \
 		.type = &g_type, \
 	}, \
 	.base_class = &g_##base, \
@@ -34,16 +34,16 @@ BUILTIN_TYPE(threadgroup, object, threadgroup_constructor);
 
 ThreadGroupObject root_threadgroup = {
 	.header.type = &g_threadgroup,
-	.header.table = &threadgroup_table,
-	.header.group = &root_threadgroup,
+	.header.table_id = TABLE_THREADGROUP,
+	.header.group_id = ROOT_GROUP_ID,
 };
 STATIC_OBJECT(root_threadgroup);
 ADD_MEMBER(builtins, "root_threadgroup", root_threadgroup);
 
 ThreadObject root_thread = {
 	.header.type = &g_thread,
-	.header.table = &thread_table,
-	.header.group = &root_threadgroup,
+	.header.table_id = TABLE_THREAD,
+	.header.group_id = ROOT_GROUP_ID,
 	.status = RUNNING,
 };
 
@@ -59,9 +59,11 @@ void gil_acquire() {
 __thread unsigned int yield_probe_counter = 0;
 
 void gil_yield(void (*sleeper)()) {
+	GC_PARK_STACK();
 	gil_release();
 	sleeper();
 	gil_acquire();
+	GC_UNPARK_STACK();
 }
 
 bool gil_probe() {
@@ -84,17 +86,24 @@ void *thread_target(void *_thread) {
 	ThreadObject *thread = _thread;
 	oly_thread = thread;
 	gil_acquire();
+#ifndef GC_PRECISE_ROOTS
+	gc_register_stack();
+#endif
 
 	Object *result = call(thread->target, thread->args);
 	if (result == NULL) {
 		thread->status = EXCEPTED;
-		thread->result = error;
+		thread->result = exc_materialize(error);
 	} else {
 		thread->status = RETURNED;
 		thread->result = result;
 	}
+	GC_WRITE(thread, thread->result);
 
 	gc_unroot((Object*)thread);
+#ifndef GC_PRECISE_ROOTS
+	gc_unregister_stack();
+#endif
 	gil_release();
 	return NULL;
 }
@@ -105,10 +114,12 @@ ThreadObject *thread_raw(Object *target, TupleObject *args, TypeObject *type, Th
 		return NULL;
 	}
 	thread->header.type = type;
-	thread->header.table = &thread_table;
+	thread->header.table_id = TABLE_THREAD;
 	// tid
 	thread->target = target;
 	thread->args = args;
+	GC_WRITE(thread, target);
+	GC_WRITE(thread, args);
 	thread->status = RUNNING;
 	thread->result = NULL;
 
@@ -130,6 +141,7 @@ bool thread_yield(Object *val) {
 	}
 	oly_thread->status = YIELDED;
 	oly_thread->result = val;
+	GC_WRITE(oly_thread, val);
 	while (oly_thread->status == YIELDED && CURRENT_INJECTED == NULL) {
 		sleep_inner(0.0000001);
 	}
@@ -163,7 +175,7 @@ Object *thread_get_attr(Object *_self, Object *name) {
 	if (object_equals_str(name, "result")) {
 		return self->result;
 	}
-	error = exc_arg(&g_AttributeError, name);
+	error = exc_lazy_arg(&g_AttributeError, name);
 	return NULL;
 }
 
@@ -182,7 +194,11 @@ Object* thread_constructor(Object *_self, TupleObject *args) {
 }
 
 ThreadGroupObject *threadgroup_raw(uint64_t mem_limit, uint64_t time_slice, TypeObject *type) {
-	if (CURRENT_GROUP->mem_limit - CURRENT_GROUP->mem_used < mem_limit || CURRENT_GROUP->yield_interval < time_slice) {
+	// the pacer won't have bothered to keep the garbage down to nothing, so go get it back before
+	// refusing. the same way an allocation over quota does: sweep, then the group, then everything
+	bool fits = CURRENT_GROUP->mem_limit - CURRENT_GROUP->mem_used >= mem_limit ||
+		(mem_limit <= CURRENT_GROUP->mem_limit && gc_reclaim(CURRENT_GROUP, mem_limit));
+	if (!fits || CURRENT_GROUP->yield_interval < time_slice) {
 		error = (Object*)&MemoryError_inst;
 		return NULL;
 	}
@@ -194,7 +210,12 @@ ThreadGroupObject *threadgroup_raw(uint64_t mem_limit, uint64_t time_slice, Type
 	}
 
 	result->header.type = type;
-	result->header.table = &threadgroup_table;
+	result->header.table_id = TABLE_THREADGROUP;
+	if (!gc_register_group(result)) {
+		// this is a harmless empty group now
+		error = (Object*)&MemoryError_inst;
+		return NULL;
+	}
 	result->mem_limit = mem_limit;
 	result->mem_used = 0;
 	result->yield_interval = time_slice;
@@ -207,8 +228,8 @@ ThreadGroupObject *threadgroup_raw(uint64_t mem_limit, uint64_t time_slice, Type
 
 void threadgroup_finalize(Object *_self) {
 	ThreadGroupObject *self = (ThreadGroupObject*)_self;
-	self->header.group->mem_limit += self->mem_limit;
-	self->header.group->yield_interval += self->yield_interval;
+	GROUP(self)->mem_limit += self->mem_limit;
+	GROUP(self)->yield_interval += self->yield_interval;
 }
 
 Object *threadgroup_constructor(Object *self, TupleObject *args) {
@@ -227,6 +248,9 @@ Object *threadgroup_constructor(Object *self, TupleObject *args) {
 void threads_init() {
 	pthread_mutex_init(&gil, NULL);
 	gil_acquire();
+#ifndef GC_PRECISE_ROOTS
+	gc_register_stack();
+#endif
 
 	char *heap_mem = getenv("HEAP_MEM");
 	if (heap_mem == NULL) {
@@ -26,10 +26,15 @@ typedef struct ThreadObject {
 
 typedef struct ThreadGroupObject {
 	ObjectHeader header;
+	uint32_t id;
 	uint64_t mem_limit;
 	uint64_t mem_used;
 	uint64_t yield_interval; // could be a time interval in the future
 	ExceptionObject *injected;
+	uint64_t gc_live;  // bytes found live by the last mark
+	uint64_t gc_allocated; // bytes allocated since then
+	uint64_t gc_cycle; // the collection which counted gc_live
+	struct GcHeap *heap; // the region this group allocates from
 } ThreadGroupObject;
 
 extern TypeObject g_thread;
@@ -43,10 +48,13 @@ ThreadObject *thread_raw(Object *target, TupleObject *args, TypeObject *type, Th
 void threadgroup_finalize(Object *self);
 Object* threadgroup_constructor(Object *self, TupleObject *args);
 
+extern pthread_mutex_t gil;
+void gil_acquire();
+void gil_release();
 void gil_yield(void (*sleeper)());
 bool gil_probe();
 bool thread_yield(Object *val);
 
 extern __thread ThreadObject *oly_thread;
-#define CURRENT_GROUP (oly_thread->header.group)
+#define CURRENT_GROUP (GROUP(oly_thread))
 #define CURRENT_INJECTED (oly_thread->injected ? oly_thread->injected : CURRENT_GROUP->injected)
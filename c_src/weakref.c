@@ -0,0 +1,167 @@
+#include "weakref.h"
+#include "errors.h"
+#include "builtins.h"
+
+/////////////////////////////////////
+/// weakref
+/////////////////////////////////////
+
+ObjectTable weakref_table = {
+	.trace = null_trace,
+	.finalize = null_finalize,
+	.get_attr = null_get_attr,
+	.set_attr = null_set_attr,
+	.del_attr = null_del_attr,
+	.call = weakref_call,
+	.size.given = sizeof(WeakRefObject),
+};
+
+Object *weakref_constructor(Object *self, TupleObject *args);
+BUILTIN_TYPE(weakref, object, weakref_constructor);
+
+WeakRefObject *weakref_raw(Object *target, TypeObject *type) {
+	WeakRefObject *result = (WeakRefObject*)gc_alloc(sizeof(WeakRefObject));
+	if (result == NULL) {
+		error = (Object*)&MemoryError_inst;
+		return NULL;
+	}
+	result->header.type = type;
+	result->header.table_id = TABLE_WEAKREF;
+	result->target = target;
+	GC_WRITE(result, target);
+	return result;
+}
+
+Object *weakref_constructor(Object *self, TupleObject *args) {
+	if (args->len != 1) {
+		error = exc_msg(&g_TypeError, "Expected 1 argument");
+		return NULL;
+	}
+	return (Object*)weakref_raw(args->data[0], (TypeObject*)self);
+}
+
+// calling the weakref gets the target back, or none if it was collected
+Object *weakref_call(Object *_self, TupleObject *args) {
+	WeakRefObject *self = (WeakRefObject*)_self;
+	if (args->len != 0) {
+		error = exc_msg(&g_TypeError, "Expected 0 arguments");
+		return NULL;
+	}
+	return self->target != NULL ? self->target : (Object*)&g_none;
+}
+
+/////////////////////////////////////
+/// weakdict
+/////////////////////////////////////
+
+ObjectTable weakdict_table = {
+	.trace = weakdict_trace,
+	.finalize = dicto_finalize,
+	.get_attr = weakdict_get_attr,
+	.set_attr = null_set_attr,
+	.del_attr = null_del_attr,
+	.call = null_call,
+	.size.computed = weakdict_size,
+};
+
+Object *weakdict_constructor(Object *self, TupleObject *args);
+BUILTIN_TYPE(weakdict, dict, weakdict_constructor);
+
+EmptyObject weakdict_cleared = {
+	.header.type = &g_nonetype,
+	.header.table_id = TABLE_NULL,
+	.header.group_id = ROOT_GROUP_ID,
+};
+STATIC_OBJECT(weakdict_cleared);
+
+WeakDictObject *weakdict_raw(TypeObject *type) {
+	WeakDictObject *result = (WeakDictObject*)gc_alloc(sizeof(WeakDictObject));
+	if (result == NULL) {
+		error = (Object*)&MemoryError_inst;
+		return NULL;
+	}
+	result->header_dict.header.type = type;
+	result->header_dict.header.table_id = TABLE_WEAKDICT;
+	return result;
+}
+
+Object *weakdict_constructor(Object *self, TupleObject *args) {
+	if (args->len != 0) {
+		error = exc_msg(&g_TypeError, "Expected 0 arguments");
+		return NULL;
+	}
+	return (Object*)weakdict_raw((TypeObject*)self);
+}
+
+size_t weakdict_size(Object *_self) {
+	WeakDictObject *self = (WeakDictObject*)_self;
+	return sizeof(WeakDictObject) + dict_size(&self->header_dict.core);
+}
+
+// only the keys are strong
+bool weakdict_trace(Object *_self, bool (*tracer)(Object *tracee)) {
+	WeakDictObject *self = (WeakDictObject*)_self;
+	bool inner_tracer(void *key, void **val) {
+		return tracer((Object*)key);
+	}
+	return dict_trace(&self->header_dict.core, inner_tracer);
+}
+
+bool weakdict_purge(WeakDictObject *self) {
+	if (self->cleared == 0) {
+		return true;
+	}
+	bool predicate(void *key, void *val) {
+		return val == &weakdict_cleared;
+	}
+	void other_dealloc(void * ptr, size_t size) { quota_dealloc(ptr, size, GROUP(self)); }
+	if (!dict_popwhere(&self->header_dict.core, predicate, other_dealloc)) {
+		return false;
+	}
+	self->cleared = 0;
+	return true;
+}
+
+Object *weakdict_get_attr(Object *self, Object *name) {
+	if (!weakdict_purge((WeakDictObject*)self)) {
+		return NULL;
+	}
+	return dicto_get_attr(self, name);
+}
+
+void weak_clear(Object *self, bool (*dead)(Object *obj)) {
+	if (self->table_id == TABLE_WEAKREF) {
+		WeakRefObject *ref = (WeakRefObject*)self;
+		if (ref->target != NULL && dead(ref->target)) {
+			ref->target = NULL;
+		}
+	} else {
+		WeakDictObject *dict = (WeakDictObject*)self;
+		bool tracer(void *key, void **val) {
+			if (dead((Object*)*val)) {
+				*val = &weakdict_cleared;
+				dict->cleared++;
+			}
+			return true;
+		}
+		dict_trace(&dict->header_dict.core, tracer);
+	}
+}
+
+// the dict methods, with the cleared entries dropped first so they never see them
+#define WEAKDICT_METHOD(name, function) \
+Object *weakdict_##name(TupleObject *args) { \
+	if (args->len >= 1 && isinstance_inner(args->data[0], &g_weakdict) && !weakdict_purge((WeakDictObject*)args->data[0])) { \
+		return NULL; \
+	} \
+	return function(args); \
+} \
+BUILTIN_METHOD(name, weakdict_##name, weakdict)
+
+WEAKDICT_METHOD(__getitem__, dict_getitem);
+WEAKDICT_METHOD(__setitem__, dict_setitem);
+WEAKDICT_METHOD(pop, dict_popitem);
+WEAKDICT_METHOD(__delitem__, dict_delitem);
+WEAKDICT_METHOD(__eq__, dict_eq);
+WEAKDICT_METHOD(__bool__, dict_bool);
+WEAKDICT_METHOD(__str__, dict_str);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "object.h"
+
+typedef struct WeakRefObject {
+	ObjectHeader header;
+	Object *target; // NULL once the gc has found it dead
+} WeakRefObject;
+Object *weakref_call(Object *self, TupleObject *args);
+WeakRefObject *weakref_raw(Object *target, TypeObject *type);
+
+// a dict which doesn't keep its values alive. when the gc finds a value dead it swaps in
+// weakdict_cleared, since C code further up the stack may be walking the chains, and the entry is
+// dropped the next time the dict is used through one of its methods.
+typedef struct WeakDictObject {
+	DictObject header_dict;
+	size_t cleared; // entries waiting to be dropped
+} WeakDictObject;
+bool weakdict_trace(Object *self, bool (*tracer)(Object *tracee));
+Object *weakdict_get_attr(Object *self, Object *name);
+size_t weakdict_size(Object *self);
+WeakDictObject *weakdict_raw(TypeObject *type);
+bool weakdict_purge(WeakDictObject *self);
+
+// called by the gc once marking is done, for each live weakref or weakdict. dead() says which
+// referents the mark didn't find
+void weak_clear(Object *self, bool (*dead)(Object *obj));
+
+extern TypeObject g_weakref;
+extern TypeObject g_weakdict;
+extern EmptyObject weakdict_cleared;